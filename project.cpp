@@ -1,16 +1,41 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstdio>
 #include <cstring>
 #include <climits>
 #include <cctype>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <cstdlib>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
-#define MAX_PORTS 15
+#define INITIAL_PORT_CAPACITY 16
 #define MAX_NAME_LENGTH 30
 #define MAX_DATE_LENGTH 11
 #define MAX_TIME_LENGTH 6
 #define MAX_COMPANY_LENGTH 15
-#define DOCKING_SLOTS 2  // Fixed: All ports have 2 docking slots
+#define DEFAULT_DOCKING_SLOTS 2  // berths at ports PortCharges.txt gives no count for
+
+#define COST_MATRIX_FILE "CostMatrix.csv"
+#define TIME_MATRIX_FILE "TimeMatrix.csv"
+#define QUOTE_REQUEST_FILE "Quotes.txt"
+#define QUOTE_RESULT_FILE "QuoteResults.txt"
+#define ROUTE_UPDATE_FILE "RouteUpdates.txt"
+#define DOCKING_SIM_FILE "DockingSimulation.csv"
+
+// Cheapest-route search algorithms
+#define SEARCH_DIJKSTRA 0
+#define SEARCH_ASTAR 1
+#define SEARCH_BIDIRECTIONAL 2
 
 // ---------------- STRUCTURES ----------------
 
@@ -41,11 +66,74 @@ struct UserPreferences {
     }
 };
 
+// UserPreferences with names resolved to ids, built once per search so the
+// per-route check is integer compares only
+struct RouteFilter {
+    bool hasCompanyFilter;
+    int companyId;          // -1 when the company is unknown (matches nothing)
+    int avoidPortIdx;       // -1 when no port is avoided
+    bool hasMaxCostLimit;
+    unsigned int maxCostLimit;
+    
+    RouteFilter() : hasCompanyFilter(false), companyId(-1), avoidPortIdx(-1),
+                    hasMaxCostLimit(false), maxCostLimit(0) {}
+    
+    bool passes(unsigned int destIdx, unsigned int cost, unsigned short company) const {
+        if (hasCompanyFilter && (int)company != companyId) return false;
+        if ((int)destIdx == avoidPortIdx) return false;
+        if (hasMaxCostLimit && cost > maxCostLimit) return false;
+        return true;
+    }
+};
+
+// Hash of the filters in prefs (NULL or no filter hashes as 0), so equal
+// preferences always hash alike
+unsigned int preferencesHash(const UserPreferences* prefs) {
+    if (!prefs || !prefs->hasAnyFilter()) return 0;
+    
+    unsigned int h = 2166136261u;
+    const unsigned int words[3] = {
+        (unsigned int)prefs->hasCompanyFilter | ((unsigned int)prefs->hasAvoidPort << 1) |
+        ((unsigned int)prefs->hasMaxCostLimit << 2) | ((unsigned int)prefs->hasMaxTimeLimit << 3),
+        prefs->hasMaxCostLimit ? prefs->maxCostLimit : 0,
+        prefs->hasMaxTimeLimit ? prefs->maxTimeLimit : 0
+    };
+    for (int i = 0; i < 3; i++) {
+        h = (h ^ words[i]) * 16777619u;
+    }
+    for (const char* c = prefs->hasCompanyFilter ? prefs->preferredCompany : ""; *c; c++) {
+        h = (h ^ (unsigned char)*c) * 16777619u;
+    }
+    h = (h ^ '/') * 16777619u;
+    for (const char* c = prefs->hasAvoidPort ? prefs->avoidPort : ""; *c; c++) {
+        h = (h ^ (unsigned char)*c) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+// True if a and b filter routes identically (NULL means no filter)
+bool samePreferences(const UserPreferences* a, const UserPreferences* b) {
+    bool aFilters = a && a->hasAnyFilter();
+    bool bFilters = b && b->hasAnyFilter();
+    if (!aFilters || !bFilters) return aFilters == bFilters;
+    
+    if (a->hasCompanyFilter != b->hasCompanyFilter || a->hasAvoidPort != b->hasAvoidPort ||
+        a->hasMaxCostLimit != b->hasMaxCostLimit || a->hasMaxTimeLimit != b->hasMaxTimeLimit) {
+        return false;
+    }
+    if (a->hasCompanyFilter && strcmp(a->preferredCompany, b->preferredCompany) != 0) return false;
+    if (a->hasAvoidPort && strcmp(a->avoidPort, b->avoidPort) != 0) return false;
+    if (a->hasMaxCostLimit && a->maxCostLimit != b->maxCostLimit) return false;
+    if (a->hasMaxTimeLimit && a->maxTimeLimit != b->maxTimeLimit) return false;
+    return true;
+}
+
 // Ship/Vessel information for queue
 struct Ship {
     char shipName[MAX_NAME_LENGTH];
     char arrivalTime[MAX_TIME_LENGTH];
     char arrivalDate[MAX_DATE_LENGTH];
+    unsigned short arrivalDay;       // day number of arrivalDate
     unsigned short arrivalMins;
     unsigned int serviceTimeNeeded;  // in minutes
     char originPort[MAX_NAME_LENGTH];
@@ -120,6 +208,11 @@ public:
         return front == NULL;
     }
     
+    // First node, for walking the queue without dequeuing
+    const QueueNode* first() const {
+        return front;
+    }
+    
     int getSize() const {
         return size;
     }
@@ -146,19 +239,103 @@ public:
     }
 };
 
-// Compact RouteNode
+// Compact RouteNode: 16 bytes of route data plus the list link.
+// Dates are day numbers (see dateToDayNumber), companies are interned ids.
 struct RouteNode {
-    unsigned char destinationIndex;
-    char voyageDate[MAX_DATE_LENGTH];
-    char departureTime[MAX_TIME_LENGTH];
-    char arrivalTime[MAX_TIME_LENGTH];
+    unsigned int destinationIndex;
+    unsigned int voyageCost;
+    unsigned short voyageDay;
     unsigned short departureMins;
     unsigned short arrivalMins;
-    unsigned int voyageCost;
-    char shippingCompany[MAX_COMPANY_LENGTH];
+    unsigned short companyId;
     RouteNode* nextRoute;
 };
 
+// Minutes until each busy berth at a port is released, as a binary
+// min-heap holding at most one entry per berth. The next berth to free up
+// is the top, so adding a ship or asking for the wait is O(log berths).
+class BerthHeap {
+private:
+    unsigned int* release;
+    unsigned short capacity;
+    unsigned short count;
+
+public:
+    BerthHeap(unsigned short berths) : count(0) {
+        release = new (nothrow) unsigned int[berths ? berths : 1];
+        capacity = release ? berths : 0;
+    }
+    
+    ~BerthHeap() {
+        delete[] release;
+    }
+    
+    unsigned short size() const {
+        return count;
+    }
+    
+    bool isFull() const {
+        return count >= capacity;
+    }
+    
+    // Minutes until a berth is free: 0 while one is idle
+    unsigned int earliest() const {
+        return isFull() && count > 0 ? release[0] : 0;
+    }
+    
+    // Entry i in heap order, for listing and saving
+    unsigned int at(unsigned short i) const {
+        return release[i];
+    }
+    
+    // Minutes until the first busy berth frees; the heap must not be empty
+    unsigned int top() const {
+        return release[0];
+    }
+    
+    // The berth that frees first goes idle
+    void pop() {
+        if (count == 0) return;
+        unsigned int last = release[--count];
+        if (count > 0) replaceEarliest(last);
+    }
+    
+    // The clock moves on by minutes; every entry must be later than that
+    void elapse(unsigned int minutes) {
+        for (unsigned short i = 0; i < count; i++) {
+            release[i] -= minutes;
+        }
+    }
+    
+    // Occupies an idle berth until minutes from now
+    void push(unsigned int minutes) {
+        if (isFull()) return;
+        unsigned short slot = count++;
+        while (slot > 0) {
+            unsigned short parent = (slot - 1) / 2;
+            if (release[parent] <= minutes) break;
+            release[slot] = release[parent];
+            slot = parent;
+        }
+        release[slot] = minutes;
+    }
+    
+    // The berth that frees first is taken again until minutes from now
+    void replaceEarliest(unsigned int minutes) {
+        if (count == 0) return;
+        unsigned short slot = 0;
+        while (true) {
+            unsigned int child = 2u * slot + 1;
+            if (child >= count) break;
+            if (child + 1 < count && release[child + 1] < release[child]) child++;
+            if (release[child] >= minutes) break;
+            release[slot] = release[child];
+            slot = (unsigned short)child;
+        }
+        release[slot] = minutes;
+    }
+};
+
 struct Port {
     char portName[MAX_NAME_LENGTH];
     unsigned short dailyDockingCharge;
@@ -167,78 +344,166 @@ struct Port {
     
     // Queue management fields
     ShipQueue* waitingQueue;
-    int occupiedSlots;
-    unsigned short currentDockedShips[DOCKING_SLOTS];  // Remaining service time
+    unsigned short dockingSlots;  // berths, from PortCharges.txt
+    BerthHeap* dockedShips;       // remaining service of the ships alongside
+    BerthHeap* berthsFree;        // when each berth frees once the queue is served
+    unsigned int lastArrival;     // minute the heaps count from, see shipArrivalKey
 };
 
-// Priority Queue Node
+// Priority Queue Node (one heap slot)
 struct PQNode {
-    unsigned char portIndex;
+    unsigned int portIndex;
     unsigned int cost;
     unsigned int heuristic;
-    PQNode* next;
 };
 
+// Indexed d-ary min-heap keyed by port. Each port sits in the heap at most
+// once, so an improved cost is a decrease-key instead of a duplicate entry.
+#define PQ_ARITY 4
+
 class PriorityQueue {
 private:
-    PQNode* head;
+    PQNode* heap;
+    int* position;      // heap slot of each port, -1 when not queued
+    unsigned int capacity;
     int size;
 
+    static unsigned int priorityOf(const PQNode& node) {
+        return (node.heuristic > 0) ? node.heuristic : node.cost;
+    }
+
+    void place(int slot, const PQNode& node) {
+        heap[slot] = node;
+        position[node.portIndex] = slot;
+    }
+
+    void siftUp(int slot) {
+        PQNode node = heap[slot];
+        unsigned int priority = priorityOf(node);
+        while (slot > 0) {
+            int parent = (slot - 1) / PQ_ARITY;
+            if (priorityOf(heap[parent]) <= priority) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, node);
+    }
+
+    void siftDown(int slot) {
+        PQNode node = heap[slot];
+        unsigned int priority = priorityOf(node);
+        while (true) {
+            int first = slot * PQ_ARITY + 1;
+            if (first >= size) break;
+            int last = first + PQ_ARITY;
+            if (last > size) last = size;
+
+            int best = first;
+            unsigned int bestPriority = priorityOf(heap[first]);
+            for (int c = first + 1; c < last; c++) {
+                unsigned int p = priorityOf(heap[c]);
+                if (p < bestPriority) {
+                    best = c;
+                    bestPriority = p;
+                }
+            }
+            if (bestPriority >= priority) break;
+            place(slot, heap[best]);
+            slot = best;
+        }
+        place(slot, node);
+    }
+
 public:
-    PriorityQueue() : head(NULL), size(0) {}
+    PriorityQueue(unsigned int portCount) : heap(NULL), position(NULL), capacity(0), size(0) {
+        if (portCount == 0) return;
+        heap = new (nothrow) PQNode[portCount];
+        position = new (nothrow) int[portCount];
+        if (!heap || !position) {
+            delete[] heap;
+            delete[] position;
+            heap = NULL;
+            position = NULL;
+            return;
+        }
+        capacity = portCount;
+        for (unsigned int i = 0; i < capacity; i++) {
+            position[i] = -1;
+        }
+    }
     
     ~PriorityQueue() {
-        while (head) {
-            PQNode* temp = head;
-            head = head->next;
-            delete temp;
-        }
+        delete[] heap;
+        delete[] position;
     }
     
-    void push(unsigned char portIdx, unsigned int cost, unsigned int heuristic = 0) {
-        PQNode* newNode = new (nothrow) PQNode();
-        if (!newNode) return;
-        
-        newNode->portIndex = portIdx;
-        newNode->cost = cost;
-        newNode->heuristic = heuristic;
-        newNode->next = NULL;
-        size++;
+    // Inserts the port, or lowers its key if it is already queued
+    void push(unsigned int portIdx, unsigned int cost, unsigned int heuristic = 0) {
+        if (portIdx >= capacity) return;
         
-        unsigned int priority = (heuristic > 0) ? heuristic : cost;
+        PQNode node;
+        node.portIndex = portIdx;
+        node.cost = cost;
+        node.heuristic = heuristic;
         
-        if (!head || priority < (head->heuristic > 0 ? head->heuristic : head->cost)) {
-            newNode->next = head;
-            head = newNode;
-            return;
-        }
-        
-        PQNode* curr = head;
-        while (curr->next) {
-            unsigned int nextPriority = (curr->next->heuristic > 0) ? 
-                                        curr->next->heuristic : curr->next->cost;
-            if (priority < nextPriority) break;
-            curr = curr->next;
+        int slot = position[portIdx];
+        if (slot == -1) {
+            slot = size++;
+            place(slot, node);
+            siftUp(slot);
+        } else if (priorityOf(node) <= priorityOf(heap[slot])) {
+            place(slot, node);
+            siftUp(slot);
         }
-        newNode->next = curr->next;
-        curr->next = newNode;
     }
     
-    bool pop(unsigned char& portIdx, unsigned int& cost, unsigned int& heuristic) {
-        if (!head) return false;
+    bool pop(unsigned int& portIdx, unsigned int& cost, unsigned int& heuristic) {
+        if (size == 0) return false;
+        
+        portIdx = heap[0].portIndex;
+        cost = heap[0].cost;
+        heuristic = heap[0].heuristic;
+        position[portIdx] = -1;
         
-        PQNode* temp = head;
-        portIdx = head->portIndex;
-        cost = head->cost;
-        heuristic = head->heuristic;
-        head = head->next;
-        delete temp;
         size--;
+        if (size > 0) {
+            place(0, heap[size]);
+            siftDown(0);
+        }
         return true;
     }
     
-    bool isEmpty() const { return head == NULL; }
+    bool contains(unsigned int portIdx) const {
+        return portIdx < capacity && position[portIdx] != -1;
+    }
+    
+    // Changes the key of a queued port in either direction
+    void update(unsigned int portIdx, unsigned int cost) {
+        if (!contains(portIdx)) return;
+        
+        int slot = position[portIdx];
+        heap[slot].cost = cost;
+        heap[slot].heuristic = 0;
+        siftUp(slot);
+        siftDown(position[portIdx]);
+    }
+    
+    // Empties the queue in O(size) so its storage can serve another search
+    void clear() {
+        for (int i = 0; i < size; i++) {
+            position[heap[i].portIndex] = -1;
+        }
+        size = 0;
+    }
+    
+    bool isEmpty() const { return size == 0; }
     int getSize() const { return size; }
+    
+    // False if the constructor could not allocate the heap
+    bool isValid() const { return heap != NULL; }
+    
+    // Key of the next port pop() would return; the queue must not be empty
+    unsigned int topPriority() const { return priorityOf(heap[0]); }
 };
 
 // ---------------- HELPER FUNCTIONS ----------------
@@ -287,11 +552,99 @@ inline int calculateLayoverHours(unsigned short arrivalMins, unsigned short depa
     return (departureMins - arrivalMins) / 60;
 }
 
+// Whole hours sailed between departure and arrival (wraps past midnight)
+inline unsigned int voyageHours(unsigned short depMins, unsigned short arrMins) {
+    if (arrMins < depMins) {
+        return ((1440 - depMins) + arrMins) / 60;
+    }
+    return (arrMins - depMins) / 60;
+}
+
+// Absolute minute (day number * 1440 + minute) a sailing leaves port
+inline unsigned int departureMinute(unsigned short day, unsigned short depMins) {
+    return (unsigned int)day * 1440 + depMins;
+}
+
+// Absolute minute a sailing reaches port; arrivals before the departure
+// time land on the following day, as in voyageHours
+inline unsigned int arrivalMinute(unsigned short day, unsigned short depMins, 
+                                  unsigned short arrMins) {
+    unsigned int arrival = (unsigned int)day * 1440 + arrMins;
+    return (arrMins < depMins) ? arrival + 1440 : arrival;
+}
+
 inline int dateToInt(const char* date) {
     return ((date[6]-'0')*10000000 + (date[7]-'0')*1000000 + (date[8]-'0')*100000 + (date[9]-'0')*10000 +
             (date[3]-'0')*1000 + (date[4]-'0')*100 + (date[0]-'0')*10 + (date[1]-'0'));
 }
 
+// Days since 01/01/1970 for a D/M/YYYY or DD/MM/YYYY date of the given
+// length (need not be NUL-terminated). 0 if malformed or impossible (31/04,
+// 29/02 outside leap years); 01/01/1970 itself is day 0 and so rejected too,
+// which leaves 0 free to mark cancelled routes.
+unsigned short parseDayNumber(const char* date, int length) {
+    if (!date || length < 8 || length >= MAX_DATE_LENGTH) return 0;
+    
+    int parts[3] = {0, 0, 0};
+    int digits[3] = {0, 0, 0};
+    int field = 0;
+    for (const char* c = date; c < date + length; c++) {
+        if (*c == '/') {
+            if (++field > 2) return 0;
+        } else if (isdigit((unsigned char)*c)) {
+            parts[field] = parts[field] * 10 + (*c - '0');
+            digits[field]++;
+        } else {
+            return 0;
+        }
+    }
+    
+    int day = parts[0], month = parts[1], year = parts[2];
+    if (field != 2 || digits[2] != 4 || month < 1 || month > 12 || year < 1970 || year > 2149) {
+        return 0;
+    }
+    static const int monthDays[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    int daysInMonth = monthDays[month - 1] + ((month == 2 && leap) ? 1 : 0);
+    if (day < 1 || day > daysInMonth) return 0;
+    
+    // Days-from-civil conversion (proleptic Gregorian calendar)
+    int y = (month <= 2) ? year - 1 : year;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (unsigned short)(era * 146097 + doe - 719468);
+}
+
+// Day number of a NUL-terminated date. Parsed once at load so route date
+// checks are integer compares.
+unsigned short dateToDayNumber(const char* date) {
+    if (!date) return 0;
+    return parseDayNumber(date, (int)strlen(date));
+}
+
+// A DD/MM/YYYY date that names a real day a route can sail on. Every
+// query entry point checks this; the day number of any other string is 0,
+// which would let a search start before every sailing.
+inline bool isValidDate(const char* date) {
+    return isValidDateFormat(date) && dateToDayNumber(date) != 0;
+}
+
+// Writes a day number back out as DD/MM/YYYY
+void dayNumberToDate(unsigned short dayNumber, char* dateStr) {
+    int z = dayNumber + 719468;
+    int era = z / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int day = doy - (153 * mp + 2) / 5 + 1;
+    int month = mp < 10 ? mp + 3 : mp - 9;
+    int year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+    sprintf(dateStr, "%02d/%02d/%04d", day, month, year);
+}
+
 inline bool isSameDateOrLater(const char* date1, const char* date2) {
     return dateToInt(date1) >= dateToInt(date2);
 }
@@ -311,388 +664,5266 @@ unsigned int calculateServiceTime(unsigned int voyageCost) {
     return (voyageCost / 10000) * 60 + 120;
 }
 
-// Compare ships by arrival date and time for sorting
-int compareShipArrival(const Ship& s1, const Ship& s2) {
-    int date1 = dateToInt(s1.arrivalDate);
-    int date2 = dateToInt(s2.arrivalDate);
+// Packed (day, minute) arrival key; fits in 27 bits
+inline unsigned int shipArrivalKey(const Ship& ship) {
+    return (unsigned int)ship.arrivalDay * 1440 + ship.arrivalMins;
+}
+
+// Stable LSD radix sort of indices by key (custom implementation, no STL).
+// Takes ownership of keys[0..count) as scratch and fills order[0..count) so
+// order[i] is the index of the i-th smallest key. Returns false if out of memory.
+bool sortIndicesByKey(unsigned int* keys, int count, int* order) {
+    const int RADIX_BITS = 8;
+    const int BUCKETS = 1 << RADIX_BITS;
+    
+    unsigned int* keysTmp = new (nothrow) unsigned int[count];
+    int* orderTmp = new (nothrow) int[count];
+    if (count > 0 && (!keysTmp || !orderTmp)) {
+        delete[] keysTmp;
+        delete[] orderTmp;
+        return false;
+    }
+    
+    unsigned int maxKey = 0;
+    for (int i = 0; i < count; i++) {
+        order[i] = i;
+        if (keys[i] > maxKey) maxKey = keys[i];
+    }
     
-    if (date1 != date2) {
-        return date1 - date2;  // Earlier date comes first
+    for (int shift = 0; shift < 32 && (maxKey >> shift) > 0; shift += RADIX_BITS) {
+        int bucketStart[BUCKETS] = {0};
+        for (int i = 0; i < count; i++) {
+            bucketStart[(keys[i] >> shift) & (BUCKETS - 1)]++;
+        }
+        int total = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            int n = bucketStart[b];
+            bucketStart[b] = total;
+            total += n;
+        }
+        for (int i = 0; i < count; i++) {
+            int slot = bucketStart[(keys[i] >> shift) & (BUCKETS - 1)]++;
+            keysTmp[slot] = keys[i];
+            orderTmp[slot] = order[i];
+        }
+        for (int i = 0; i < count; i++) {
+            keys[i] = keysTmp[i];
+            order[i] = orderTmp[i];
+        }
     }
     
-    // Same date, compare by time
-    return s1.arrivalMins - s2.arrivalMins;
+    delete[] keysTmp;
+    delete[] orderTmp;
+    return true;
 }
 
-// Simple bubble sort for ships (custom implementation, no STL)
-void sortShipsByArrival(Ship* ships, int count) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (compareShipArrival(ships[j], ships[j + 1]) > 0) {
-                // Swap ships
-                Ship temp = ships[j];
-                ships[j] = ships[j + 1];
-                ships[j + 1] = temp;
-            }
-        }
+// Fills order[0..count) so ships[order[i]] is the i-th arrival; only 4-byte
+// indices move, never Ship structs. Returns false if out of memory.
+bool sortShipsByArrival(const Ship* ships, int count, int* order) {
+    unsigned int* keys = new (nothrow) unsigned int[count];
+    if (count > 0 && !keys) return false;
+    
+    for (int i = 0; i < count; i++) {
+        keys[i] = shipArrivalKey(ships[i]);
     }
+    bool sorted = sortIndicesByKey(keys, count, order);
+    delete[] keys;
+    return sorted;
 }
 
-// ---------------- GRAPH CLASS ----------------
-class Graph {
+// Growable contiguous buffer of ships for the arrival simulation. Reserved
+// up front from the schedule's line count, doubling if that was short.
+class ShipBuffer {
 private:
-    Port ports[MAX_PORTS];
-    unsigned char totalPorts;
+    Ship* ships;
+    int count;
+    int capacity;
+
+public:
+    ShipBuffer() : ships(NULL), count(0), capacity(0) {}
     
-    unsigned int calculateHeuristic(unsigned char fromPort, unsigned char toPort) const {
-        if (fromPort == toPort) return 0;
-        
-        RouteNode* route = ports[fromPort].routeListHead;
-        unsigned int minDirectCost = UINT_MAX;
-        
-        while (route) {
-            if (route->destinationIndex == toPort) {
-                if (route->voyageCost < minDirectCost) {
-                    minDirectCost = route->voyageCost;
-                }
-            }
-            route = route->nextRoute;
-        }
-        
-        if (minDirectCost != UINT_MAX) {
-            return minDirectCost;
-        }
-        
-        return 5000;
+    ~ShipBuffer() {
+        delete[] ships;
     }
     
-    bool matchesPreferences(const RouteNode* route, unsigned char portIndex, 
-                           const UserPreferences& prefs) const {
-        if (!route) return false;
-        
-        if (prefs.hasCompanyFilter) {
-            if (strcmp(route->shippingCompany, prefs.preferredCompany) != 0) {
-                return false;
-            }
-        }
+    bool reserve(int needed) {
+        if (needed <= capacity) return true;
         
-        if (prefs.hasAvoidPort) {
-            if (strcmp(ports[route->destinationIndex].portName, prefs.avoidPort) == 0) {
-                return false;
-            }
-        }
+        Ship* grown = new (nothrow) Ship[needed];
+        if (!grown) return false;
         
-        if (prefs.hasMaxCostLimit) {
-            if (route->voyageCost > prefs.maxCostLimit) {
-                return false;
-            }
+        for (int i = 0; i < count; i++) {
+            grown[i] = ships[i];
         }
-        
+        delete[] ships;
+        ships = grown;
+        capacity = needed;
         return true;
     }
     
-    unsigned int calculateVoyageTime(const RouteNode* route) const {
-        if (!route) return 0;
-        
-        int depMins = route->departureMins;
-        int arrMins = route->arrivalMins;
-        
-        int totalMinutes;
-        if (arrMins < depMins) {
-            totalMinutes = (1440 - depMins) + arrMins;
-        } else {
-            totalMinutes = arrMins - depMins;
+    // Returns a fresh slot at the end, or NULL if out of memory
+    Ship* append() {
+        if (count == capacity && !reserve(capacity ? capacity * 2 : 64)) {
+            return NULL;
         }
-        
-        return totalMinutes / 60;
+        return &ships[count++];
     }
     
-    bool hasValidDirectRoute(int srcIdx, int destIdx, const char* date, 
-                            const UserPreferences* prefs) const {
-        if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx)) return false;
-        
-        RouteNode* route = ports[srcIdx].routeListHead;
-        
-        while (route) {
-            if (route->destinationIndex == destIdx) {
-                if (isSameDateOrLater(route->voyageDate, date)) {
-                    if (prefs) {
-                        if (!matchesPreferences(route, destIdx, *prefs)) {
-                            route = route->nextRoute;
-                            continue;
-                        }
-                    }
-                    return true;
-                }
-            }
-            route = route->nextRoute;
+    const Ship* data() const { return ships; }
+    int size() const { return count; }
+};
+
+// Per-search scratch arrays, sized to the number of loaded ports. Searches
+// reuse one scratch: begin() starts a new generation and touch() resets a
+// port's labels the first time that search looks at it, so a query costs
+// only the ports it reaches rather than all of them.
+struct SearchScratch {
+    unsigned int* minCost;
+    unsigned int* totalTime;
+    unsigned int* queueWaitTime;
+    bool* visited;
+    int* prevPort;
+    int* viaEdge;
+    RouteNode** usedRoute;
+    unsigned int* path;
+    RouteNode** pathRoutes;
+    PriorityQueue queue;
+    unsigned int* stamp;            // generation that last reset each port
+    unsigned int generation;
+    unsigned int capacity;
+    
+    SearchScratch(unsigned int portCount) : queue(portCount), generation(0), capacity(portCount) {
+        minCost = new (nothrow) unsigned int[portCount];
+        totalTime = new (nothrow) unsigned int[portCount];
+        queueWaitTime = new (nothrow) unsigned int[portCount];
+        visited = new (nothrow) bool[portCount];
+        prevPort = new (nothrow) int[portCount];
+        viaEdge = new (nothrow) int[portCount];
+        usedRoute = new (nothrow) RouteNode*[portCount];
+        path = new (nothrow) unsigned int[portCount];
+        pathRoutes = new (nothrow) RouteNode*[portCount];
+        stamp = new (nothrow) unsigned int[portCount];
+        for (unsigned int i = 0; stamp && i < portCount; i++) {
+            stamp[i] = 0;
         }
-        
-        return false;
     }
     
-    // Calculate queue wait time at a port for a given arrival time
-    unsigned int calculateQueueWaitTime(int portIdx, const char* arrivalDate, 
-                                       unsigned short arrivalMins) const {
-        if (!isValidPortIndex(portIdx)) return 0;
-        
-        // Get current queue state
-        int queueSize = ports[portIdx].waitingQueue->getSize();
-        int availableSlots = DOCKING_SLOTS - ports[portIdx].occupiedSlots;
-        
-        // If slots available and no queue, no wait time
-        if (availableSlots > 0 && queueSize == 0) {
-            return 0;
-        }
-        
-        // Calculate total wait time based on ships ahead in queue
-        unsigned int totalWaitMinutes = 0;
-        
-        // If all slots are occupied, need to wait for current ships to finish
-        if (availableSlots <= 0) {
-            // Find minimum remaining service time of docked ships
-            unsigned int minServiceTime = UINT_MAX;
-            for (int i = 0; i < DOCKING_SLOTS; i++) {
-                if (ports[portIdx].currentDockedShips[i] > 0 && 
-                    ports[portIdx].currentDockedShips[i] < minServiceTime) {
-                    minServiceTime = ports[portIdx].currentDockedShips[i];
-                }
-            }
-            
-            if (minServiceTime != UINT_MAX) {
-                totalWaitMinutes += minServiceTime;
-            }
-        }
-        
-        // Add wait time for ships in queue
-        // Need to estimate service time for each ship in queue
-        // Since we don't have direct access to queue internals, use estimation
-        if (queueSize > 0) {
-            // Each position in queue adds average service time
-            // Position = (queueSize / DOCKING_SLOTS) gives number of "rounds"
-            int myPosition = queueSize + 1;  // Position if we join queue now
-            int roundsToWait = (myPosition - 1) / DOCKING_SLOTS;
-            
-            if (roundsToWait > 0) {
-                // Average service time per ship is ~3 hours = 180 minutes
-                // This is a reasonable estimate based on typical cargo operations
-                totalWaitMinutes += roundsToWait * 180;
-            }
-        }
-        
-        return totalWaitMinutes;
+    ~SearchScratch() {
+        delete[] minCost;
+        delete[] totalTime;
+        delete[] queueWaitTime;
+        delete[] visited;
+        delete[] prevPort;
+        delete[] viaEdge;
+        delete[] usedRoute;
+        delete[] path;
+        delete[] pathRoutes;
+        delete[] stamp;
     }
     
-    // Simulate ship arrival and queue management
-    void simulateShipArrival(int portIdx, const Ship& ship) {
-        if (!isValidPortIndex(portIdx)) return;
-        
-        if (ports[portIdx].occupiedSlots < DOCKING_SLOTS) {
-            // Slot available, dock immediately
-            ports[portIdx].occupiedSlots++;
-            ports[portIdx].currentDockedShips[ports[portIdx].occupiedSlots - 1] = 
-                ship.serviceTimeNeeded;
-        } else {
-            // All slots occupied, add to queue
-            ports[portIdx].waitingQueue->enqueue(ship);
-        }
+    bool isValid() const {
+        return minCost && totalTime && queueWaitTime && visited && prevPort && viaEdge && 
+               usedRoute && path && pathRoutes && stamp && queue.isValid();
     }
     
-    // Process port queues (simulate time passing)
-    void processPortQueues(int portIdx, unsigned int timeElapsed) {
-        if (!isValidPortIndex(portIdx)) return;
-        
-        // Reduce service time for docked ships
-        for (int i = 0; i < DOCKING_SLOTS; i++) {
-            if (ports[portIdx].currentDockedShips[i] > 0) {
-                if (ports[portIdx].currentDockedShips[i] >= timeElapsed) {
-                    ports[portIdx].currentDockedShips[i] -= timeElapsed;
-                } else {
-                    ports[portIdx].currentDockedShips[i] = 0;
-                }
-                
-                // If ship finished, free the slot and dock next from queue
-                if (ports[portIdx].currentDockedShips[i] == 0) {
-                    ports[portIdx].occupiedSlots--;
-                    
-                    Ship nextShip;
-                    if (ports[portIdx].waitingQueue->dequeue(nextShip)) {
-                        ports[portIdx].occupiedSlots++;
-                        ports[portIdx].currentDockedShips[i] = nextShip.serviceTimeNeeded;
-                    }
-                }
+    // Starts a new search: every port counts as untouched
+    void begin() {
+        if (++generation == 0) {    // wrapped, so old stamps could match again
+            for (unsigned int i = 0; i < capacity; i++) {
+                stamp[i] = 0;
             }
+            generation = 1;
         }
+        queue.clear();
     }
-
-public:
-    Graph() : totalPorts(0) {}
-
-    int getPortIndex(const char* portName) const {
-        if (!portName) return -1;
-        for (unsigned char i = 0; i < totalPorts; i++) {
-            if (strcmp(ports[i].portName, portName) == 0)
-                return i;
-        }
-        return -1;
+    
+    // Resets port to unreached unless this search has already touched it
+    void touch(unsigned int port) {
+        if (stamp[port] == generation) return;
+        stamp[port] = generation;
+        minCost[port] = UINT_MAX;
+        totalTime[port] = 0;
+        queueWaitTime[port] = 0;
+        visited[port] = false;
+        prevPort[port] = -1;
+        viaEdge[port] = -1;
+        usedRoute[port] = NULL;
     }
+};
 
-    inline bool isValidPortIndex(int index) const {
-        return (index >= 0 && index < totalPorts);
-    }
+#define SEARCH_SCRATCH_SLOTS 2      // independent scratches per thread
 
-    void loadPortCharges() {
-        ifstream file("PortCharges.txt");
-        if (!file.is_open()) {
-            cout << "Error: Could not open PortCharges.txt\n";
-            return;
+// The calling thread's scratch in the given slot, grown to hold portCount
+// ports and kept for its later searches. NULL if memory ran out.
+SearchScratch* threadSearchScratch(unsigned int portCount, int slot = 0) {
+    struct Holder {
+        SearchScratch* scratch[SEARCH_SCRATCH_SLOTS];
+        
+        Holder() {
+            for (int i = 0; i < SEARCH_SCRATCH_SLOTS; i++) {
+                scratch[i] = NULL;
+            }
         }
-
-        char name[MAX_NAME_LENGTH];
-        int charge;
         
-        while (file >> name >> charge && totalPorts < MAX_PORTS) {
-            if (charge < 0) continue;
-            
-            strcpy(ports[totalPorts].portName, name);
-            ports[totalPorts].dailyDockingCharge = (unsigned short)charge;
-            ports[totalPorts].routeListHead = NULL;
-            ports[totalPorts].routeListTail = NULL;
-            ports[totalPorts].waitingQueue = new ShipQueue();
-            ports[totalPorts].occupiedSlots = 0;
-            for (int i = 0; i < DOCKING_SLOTS; i++) {
-                ports[totalPorts].currentDockedShips[i] = 0;
+        ~Holder() {
+            for (int i = 0; i < SEARCH_SCRATCH_SLOTS; i++) {
+                delete scratch[i];
             }
-            totalPorts++;
         }
-
-        file.close();
-        cout << "Loaded " << (int)totalPorts << " ports.\n";
+    };
+    static thread_local Holder holder;
+    
+    SearchScratch*& scratch = holder.scratch[slot];
+    if (!scratch || scratch->capacity < portCount) {
+        delete scratch;
+        scratch = new (nothrow) SearchScratch(portCount);
+        if (scratch && !scratch->isValid()) {
+            delete scratch;
+            scratch = NULL;
+        }
     }
+    return scratch;
+}
 
-    void loadRoutes() {
-        ifstream file("Routes.txt");
-        if (!file.is_open()) {
-            cout << "Error: Could not open Routes.txt\n";
-            return;
-        }
+// Outcome of Graph::queryCheapestRoute
+#define QUERY_FOUND 0
+#define QUERY_NO_ROUTE 1
+#define QUERY_INVALID_PORT 2
+#define QUERY_INVALID_DATE 3
+#define QUERY_SAME_PORT 4
+#define QUERY_AVOIDS_ENDPOINT 5     // avoided port is the source or destination
+#define QUERY_NO_MEMORY 6
 
-        char origin[MAX_NAME_LENGTH], dest[MAX_NAME_LENGTH];
-        char date[MAX_DATE_LENGTH], depTime[MAX_TIME_LENGTH], arrTime[MAX_TIME_LENGTH];
-        char company[MAX_COMPANY_LENGTH];
-        int cost, loaded = 0;
-        
-        // Temporary array to store all ships before sorting
-        const int MAX_SHIPS = 500;  // Allocate space for ships
-        Ship* allShips = new Ship[MAX_SHIPS];
-        int shipCount = 0;
+// Outcome of the Graph::addRoute/cancelRoute/repriceRoute updates
+#define UPDATE_APPLIED 0
+#define UPDATE_NOT_FOUND 1          // no live route with that key
+#define UPDATE_INVALID_PORT 2
+#define UPDATE_NO_MEMORY 3
+#define UPDATE_INVALID_COMPANY 4    // company name too long or company table full
 
-        while (file >> origin >> dest >> date >> depTime >> arrTime >> cost >> company) {
-            int fromIdx = getPortIndex(origin);
-            int toIdx = getPortIndex(dest);
+// A cheapest route as plain data. path and legs point into the caller's
+// SearchScratch: path[0] is the source, and legs[i] sails path[i] -> path[i + 1].
+struct RouteResult {
+    int status;                     // QUERY_* code
+    int algorithm;                  // SEARCH_* actually run
+    bool usedHierarchy;             // answered by the contraction hierarchy
+    const unsigned int* path;
+    RouteNode* const* legs;
+    unsigned int portCount;         // ports on the path, legs is one shorter
+    unsigned int cost;              // voyage cost plus queue penalties
+    unsigned int hours;
+    unsigned int queueWaitHours;
+    unsigned int dockingCharges;    // daily charge of every port on the path
+    unsigned int nodesExplored;
+    unsigned int routesFiltered;
+    
+    RouteResult() : status(QUERY_NO_ROUTE), algorithm(SEARCH_DIJKSTRA), usedHierarchy(false),
+                    path(NULL), legs(NULL), portCount(0), cost(0), hours(0), queueWaitHours(0),
+                    dockingCharges(0), nodesExplored(0), routesFiltered(0) {}
+};
 
-            if (fromIdx == -1 || toIdx == -1 || cost < 0) continue;
+// One request for Graph::answerBatch
+struct RouteQuery {
+    int srcIdx;
+    int destIdx;
+    const char* date;                   // DD/MM/YYYY
+    const UserPreferences* prefs;       // NULL for no filters
+};
 
-            RouteNode* node = new (nothrow) RouteNode();
-            if (!node) break;
-
-            node->destinationIndex = (unsigned char)toIdx;
-            strcpy(node->voyageDate, date);
-            strcpy(node->departureTime, depTime);
-            strcpy(node->arrivalTime, arrTime);
-            node->departureMins = timeToMinutes(depTime);
-            node->arrivalMins = timeToMinutes(arrTime);
-            node->voyageCost = (unsigned int)cost;
-            strcpy(node->shippingCompany, company);
-            node->nextRoute = NULL;
+// Ports a search may stop after settling: those with mark[p] == id
+struct SearchTargets {
+    const unsigned int* mark;
+    unsigned int id;
+    unsigned int remaining;
+};
 
-            if (!ports[fromIdx].routeListHead) {
-                ports[fromIdx].routeListHead = node;
-                ports[fromIdx].routeListTail = node;
-            } else {
-                ports[fromIdx].routeListTail->nextRoute = node;
-                ports[fromIdx].routeListTail = node;
-            }
-            
-            // Create ship for queue simulation (store in array first)
-            if (shipCount < MAX_SHIPS) {
-                Ship& ship = allShips[shipCount];
-                sprintf(ship.shipName, "%s_%s_%d", company, date, shipCount);
-                strcpy(ship.arrivalTime, arrTime);
-                strcpy(ship.arrivalDate, date);
-                ship.arrivalMins = timeToMinutes(arrTime);
-                ship.serviceTimeNeeded = calculateServiceTime(cost);
-                strcpy(ship.originPort, origin);
-                strcpy(ship.destinationPort, dest);
-                strcpy(ship.company, company);
-                ship.voyageCost = cost;
-                
-                shipCount++;
-            }
-            
-            loaded++;
-        }
+// One search engine's tally in Graph::verifySearchEngines
+#define VERIFY_MAX_PAIRS 50000      // past this, source ports are sampled evenly
+#define VERIFY_LOADER_CHUNKS 4      // chunks for the self-check's parallel load
 
-        file.close();
-        
+struct EngineCheck {
+    const char* name;
+    unsigned int pairs;
+    unsigned int mismatches;
+    unsigned int fellBack;          // pairs it handed on to a full search
+    
+    explicit EngineCheck(const char* engine) : name(engine), pairs(0), mismatches(0), fellBack(0) {}
+};
+
+// Dense all-pairs result: row `from` holds the cheapest cost and the hours
+// of that route to every port, UINT_MAX where a port is unreachable
+struct CostMatrix {
+    unsigned int portCount;
+    unsigned int* cost;
+    unsigned int* hours;
+    
+    CostMatrix(unsigned int ports) : portCount(ports) {
+        unsigned long long cells = (unsigned long long)ports * ports;
+        cost = new (nothrow) unsigned int[cells ? cells : 1];
+        hours = new (nothrow) unsigned int[cells ? cells : 1];
+    }
+    
+    ~CostMatrix() {
+        delete[] cost;
+        delete[] hours;
+    }
+    
+    bool isValid() const {
+        return cost && hours;
+    }
+    
+    unsigned int* costRow(unsigned int from) { return cost + (unsigned long long)from * portCount; }
+    unsigned int* hoursRow(unsigned int from) { return hours + (unsigned long long)from * portCount; }
+};
+
+// ---------------- PARETO LABELS ----------------
+// Multi-criteria search state. A label is one partial itinerary ending at a
+// port; a port keeps only labels no other label there beats on all of cost,
+// hours and legs, and at most MAX_LABELS_PER_PORT of them.
+
+#define MAX_LABELS_PER_PORT 16
+
+struct Label {
+    unsigned int cost;
+    unsigned int hours;
+    unsigned int legs;
+    unsigned int port;
+    int parent;         // label this one extends, -1 at the source
+    int edge;           // CSR edge taken from the parent
+    int nextAtPort;     // next live label at the same port
+    bool alive;         // false once dominated
+};
+
+// a is at least as good as b on every criterion
+inline bool labelCovers(unsigned int cost, unsigned int hours, unsigned int legs, const Label& b) {
+    return cost <= b.cost && hours <= b.hours && legs <= b.legs;
+}
+
+inline bool labelCovers(const Label& a, unsigned int cost, unsigned int hours, unsigned int legs) {
+    return a.cost <= cost && a.hours <= hours && a.legs <= legs;
+}
+
+// Label pool plus the per-port lists of live labels
+class LabelSet {
+private:
+    Label* labels;
+    int count;
+    int capacity;
+    int* portHead;
+    unsigned int* portLive;
+    unsigned int portCount;
+
+public:
+    LabelSet(unsigned int ports) : labels(NULL), count(0), capacity(0), 
+                                   portHead(NULL), portLive(NULL), portCount(0) {
+        portHead = new (nothrow) int[ports];
+        portLive = new (nothrow) unsigned int[ports];
+        if (!portHead || !portLive) return;
+        for (unsigned int i = 0; i < ports; i++) {
+            portHead[i] = -1;
+            portLive[i] = 0;
+        }
+        portCount = ports;
+    }
+    
+    ~LabelSet() {
+        delete[] labels;
+        delete[] portHead;
+        delete[] portLive;
+    }
+    
+    bool isValid() const { return portHead && portLive; }
+    
+    const Label& operator[](int id) const { return labels[id]; }
+    
+    // True if a live label at port is at least as good on every criterion
+    bool isDominated(unsigned int port, unsigned int cost, unsigned int hours, 
+                     unsigned int legs) const {
+        for (int id = portHead[port]; id != -1; id = labels[id].nextAtPort) {
+            if (labelCovers(labels[id], cost, hours, legs)) return true;
+        }
+        return false;
+    }
+    
+    // Adds a label the caller has checked is not dominated, retiring the
+    // labels it dominates. Returns its id, or -1 if the port is full or
+    // memory ran out.
+    int add(unsigned int port, unsigned int cost, unsigned int hours, unsigned int legs,
+            int parent, int edge) {
+        int* link = &portHead[port];
+        while (*link != -1) {
+            Label& old = labels[*link];
+            if (labelCovers(cost, hours, legs, old)) {
+                old.alive = false;
+                portLive[port]--;
+                *link = old.nextAtPort;
+            } else {
+                link = &old.nextAtPort;
+            }
+        }
+        if (portLive[port] >= MAX_LABELS_PER_PORT) return -1;
+        
+        if (count == capacity) {
+            int newCapacity = capacity ? capacity * 2 : 64;
+            Label* grown = new (nothrow) Label[newCapacity];
+            if (!grown) return -1;
+            for (int i = 0; i < count; i++) {
+                grown[i] = labels[i];
+            }
+            delete[] labels;
+            labels = grown;
+            capacity = newCapacity;
+        }
+        
+        Label& label = labels[count];
+        label.cost = cost;
+        label.hours = hours;
+        label.legs = legs;
+        label.port = port;
+        label.parent = parent;
+        label.edge = edge;
+        label.nextAtPort = portHead[port];
+        label.alive = true;
+        portHead[port] = count;
+        portLive[port]++;
+        return count++;
+    }
+    
+    int size() const { return count; }
+};
+
+struct LabelHeapNode {
+    unsigned int cost;
+    unsigned int hours;
+    unsigned int legs;
+    int label;
+};
+
+// d-ary min-heap of labels in lexicographic (cost, hours, legs) order, so a
+// popped label can never be dominated by one popped later. Dominated labels
+// stay queued and are skipped when popped.
+class LabelHeap {
+private:
+    LabelHeapNode* heap;
+    int size;
+    int capacity;
+    
+    static bool before(const LabelHeapNode& a, const LabelHeapNode& b) {
+        if (a.cost != b.cost) return a.cost < b.cost;
+        if (a.hours != b.hours) return a.hours < b.hours;
+        return a.legs < b.legs;
+    }
+
+public:
+    LabelHeap() : heap(NULL), size(0), capacity(0) {}
+    
+    ~LabelHeap() {
+        delete[] heap;
+    }
+    
+    bool push(const Label& label, int id) {
+        if (size == capacity) {
+            int newCapacity = capacity ? capacity * 2 : 64;
+            LabelHeapNode* grown = new (nothrow) LabelHeapNode[newCapacity];
+            if (!grown) return false;
+            for (int i = 0; i < size; i++) {
+                grown[i] = heap[i];
+            }
+            delete[] heap;
+            heap = grown;
+            capacity = newCapacity;
+        }
+        
+        LabelHeapNode node;
+        node.cost = label.cost;
+        node.hours = label.hours;
+        node.legs = label.legs;
+        node.label = id;
+        
+        int slot = size++;
+        while (slot > 0) {
+            int parent = (slot - 1) / PQ_ARITY;
+            if (!before(node, heap[parent])) break;
+            heap[slot] = heap[parent];
+            slot = parent;
+        }
+        heap[slot] = node;
+        return true;
+    }
+    
+    int pop() {
+        if (size == 0) return -1;
+        int top = heap[0].label;
+        
+        LabelHeapNode node = heap[--size];
+        int slot = 0;
+        while (true) {
+            int first = slot * PQ_ARITY + 1;
+            if (first >= size) break;
+            int last = first + PQ_ARITY;
+            if (last > size) last = size;
+            
+            int best = first;
+            for (int c = first + 1; c < last; c++) {
+                if (before(heap[c], heap[best])) best = c;
+            }
+            if (!before(heap[best], node)) break;
+            heap[slot] = heap[best];
+            slot = best;
+        }
+        if (size > 0) heap[slot] = node;
+        return top;
+    }
+    
+    bool isEmpty() const { return size == 0; }
+};
+
+// ---------------- PORT NAME INDEX ----------------
+
+// FNV-1a hash of a name of the given length
+inline unsigned int hashPortName(const char* name, int length) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// True if the NUL-terminated stored name equals the first length chars of name
+inline bool nameEquals(const char* stored, const char* name, int length) {
+    return strncmp(stored, name, length) == 0 && stored[length] == '\0';
+}
+
+struct NameSlot {
+    unsigned int hash;
+    int id;             // -1 marks an empty slot
+};
+
+// Open-addressing (linear probing) hash index from port name to port index.
+// Names live in the port registry, so lookups are given the current array.
+class PortNameIndex {
+private:
+    NameSlot* slots;
+    unsigned int capacity;  // always a power of two
+    unsigned int count;
+    
+    bool grow() {
+        unsigned int newCapacity = capacity ? capacity * 2 : 32;
+        NameSlot* grown = new (nothrow) NameSlot[newCapacity];
+        if (!grown) return false;
+        
+        for (unsigned int i = 0; i < newCapacity; i++) {
+            grown[i].id = -1;
+        }
+        for (unsigned int i = 0; i < capacity; i++) {
+            if (slots[i].id == -1) continue;
+            unsigned int j = slots[i].hash & (newCapacity - 1);
+            while (grown[j].id != -1) {
+                j = (j + 1) & (newCapacity - 1);
+            }
+            grown[j] = slots[i];
+        }
+        
+        delete[] slots;
+        slots = grown;
+        capacity = newCapacity;
+        return true;
+    }
+
+public:
+    PortNameIndex() : slots(NULL), capacity(0), count(0) {}
+    
+    ~PortNameIndex() {
+        delete[] slots;
+    }
+    
+    // Looks up a name that need not be NUL-terminated (e.g. a file token)
+    int find(const char* name, int length, const Port* ports) const {
+        if (!name || count == 0) return -1;
+        
+        unsigned int hash = hashPortName(name, length);
+        unsigned int i = hash & (capacity - 1);
+        while (slots[i].id != -1) {
+            if (slots[i].hash == hash && 
+                nameEquals(ports[slots[i].id].portName, name, length)) {
+                return slots[i].id;
+            }
+            i = (i + 1) & (capacity - 1);
+        }
+        return -1;
+    }
+    
+    int find(const char* name, const Port* ports) const {
+        if (!name) return -1;
+        return find(name, (int)strlen(name), ports);
+    }
+    
+    // Adds a name; the first port registered under a name keeps it
+    bool insert(const char* name, int portIndex, const Port* ports) {
+        if (find(name, ports) != -1) return true;
+        if ((count + 1) * 2 > capacity && !grow()) return false;
+        
+        unsigned int hash = hashPortName(name, (int)strlen(name));
+        unsigned int i = hash & (capacity - 1);
+        while (slots[i].id != -1) {
+            i = (i + 1) & (capacity - 1);
+        }
+        slots[i].hash = hash;
+        slots[i].id = portIndex;
+        count++;
+        return true;
+    }
+};
+
+// ---------------- COMPANY NAME INTERNING ----------------
+
+// Interns shipping company names to dense ids 0..count-1 so routes carry a
+// 2-byte id and company filters compare integers.
+class NameTable {
+private:
+    char (*names)[MAX_COMPANY_LENGTH];
+    unsigned int count;
+    unsigned int nameCapacity;
+    NameSlot* slots;            // open-addressing index into names
+    unsigned int slotCapacity;  // always a power of two
+    
+    bool growSlots() {
+        unsigned int newCapacity = slotCapacity ? slotCapacity * 2 : 32;
+        NameSlot* grown = new (nothrow) NameSlot[newCapacity];
+        if (!grown) return false;
+        
+        for (unsigned int i = 0; i < newCapacity; i++) {
+            grown[i].id = -1;
+        }
+        for (unsigned int i = 0; i < slotCapacity; i++) {
+            if (slots[i].id == -1) continue;
+            unsigned int j = slots[i].hash & (newCapacity - 1);
+            while (grown[j].id != -1) {
+                j = (j + 1) & (newCapacity - 1);
+            }
+            grown[j] = slots[i];
+        }
+        
+        delete[] slots;
+        slots = grown;
+        slotCapacity = newCapacity;
+        return true;
+    }
+    
+    bool growNames() {
+        unsigned int newCapacity = nameCapacity ? nameCapacity * 2 : 16;
+        char (*grown)[MAX_COMPANY_LENGTH] = new (nothrow) char[newCapacity][MAX_COMPANY_LENGTH];
+        if (!grown) return false;
+        
+        for (unsigned int i = 0; i < count; i++) {
+            strcpy(grown[i], names[i]);
+        }
+        delete[] names;
+        names = grown;
+        nameCapacity = newCapacity;
+        return true;
+    }
+
+public:
+    NameTable() : names(NULL), count(0), nameCapacity(0), slots(NULL), slotCapacity(0) {}
+    
+    ~NameTable() {
+        delete[] names;
+        delete[] slots;
+    }
+    
+    int find(const char* name, int length) const {
+        if (!name || count == 0) return -1;
+        
+        unsigned int hash = hashPortName(name, length);
+        unsigned int i = hash & (slotCapacity - 1);
+        while (slots[i].id != -1) {
+            if (slots[i].hash == hash && nameEquals(names[slots[i].id], name, length)) {
+                return slots[i].id;
+            }
+            i = (i + 1) & (slotCapacity - 1);
+        }
+        return -1;
+    }
+    
+    int find(const char* name) const {
+        if (!name) return -1;
+        return find(name, (int)strlen(name));
+    }
+    
+    // Returns the id for the first length chars of name, adding it if new
+    // (-1 if too long, out of ids or out of memory)
+    int intern(const char* name, int length) {
+        int id = find(name, length);
+        if (id != -1) return id;
+        if (length >= MAX_COMPANY_LENGTH || count > USHRT_MAX) return -1;
+        
+        if (count == nameCapacity && !growNames()) return -1;
+        if ((count + 1) * 2 > slotCapacity && !growSlots()) return -1;
+        
+        memcpy(names[count], name, length);
+        names[count][length] = '\0';
+        
+        unsigned int hash = hashPortName(name, length);
+        unsigned int i = hash & (slotCapacity - 1);
+        while (slots[i].id != -1) {
+            i = (i + 1) & (slotCapacity - 1);
+        }
+        slots[i].hash = hash;
+        slots[i].id = (int)count;
+        return (int)count++;
+    }
+    
+    const char* name(unsigned int id) const {
+        return (id < count) ? names[id] : "";
+    }
+    
+    unsigned int size() const { return count; }
+};
+
+// ---------------- CSR ROUTE STORAGE ----------------
+
+// Frozen compressed-sparse-row copy of the per-port route lists, built once
+// after loading. Every field the search reads per edge is kept in parallel
+// arrays; the RouteNode pointer is only kept to report the chosen legs.
+// A cancelled route keeps its slot with voyageDay CANCELLED_DAY and a NULL
+// route pointer; every search skips it with isCancelled rather than relying
+// on the date check. A later route from the same port may reuse the slot.
+
+#define CANCELLED_DAY 0     // parseDayNumber returns 0 only for invalid dates
+#define CSR_SPARE_SLOTS 2   // free slots per port, at least, once the CSR has to grow
+#define CSR_SPARE_SHIFT 3   // or routes >> 3 of them (routes >> 1 for the port that ran out)
+
+struct RouteCSR {
+    unsigned int* offsets;          // portCount + 1 entries
+    unsigned int* destination;
+    unsigned short* departureMins;
+    unsigned short* arrivalMins;
+    unsigned int* voyageCost;
+    unsigned short* voyageDay;
+    unsigned short* companyId;
+    RouteNode** route;
+    unsigned int* source;           // origin port of each edge   } timetable view,
+    int* byDeparture;               // edges by departure minute  } see buildDepartureOrder
+    unsigned int* inOffsets;        // portCount + 1 entries      } reverse view,
+    unsigned int* inEdges;          // edge ids grouped by target } see buildReverse
+    unsigned int portCount;
+    unsigned int edgeCount;
+    
+    RouteCSR() : offsets(NULL), destination(NULL), departureMins(NULL), arrivalMins(NULL),
+                 voyageCost(NULL), voyageDay(NULL), companyId(NULL), route(NULL),
+                 source(NULL), byDeparture(NULL), inOffsets(NULL), inEdges(NULL),
+                 portCount(0), edgeCount(0) {}
+    
+    ~RouteCSR() {
+        clear();
+    }
+    
+    void clear() {
+        delete[] offsets;
+        delete[] destination;
+        delete[] departureMins;
+        delete[] arrivalMins;
+        delete[] voyageCost;
+        delete[] voyageDay;
+        delete[] companyId;
+        delete[] route;
+        delete[] source;
+        delete[] byDeparture;
+        delete[] inOffsets;
+        delete[] inEdges;
+        offsets = NULL;
+        destination = NULL;
+        departureMins = NULL;
+        arrivalMins = NULL;
+        voyageCost = NULL;
+        voyageDay = NULL;
+        companyId = NULL;
+        route = NULL;
+        source = NULL;
+        byDeparture = NULL;
+        inOffsets = NULL;
+        inEdges = NULL;
+        portCount = 0;
+        edgeCount = 0;
+    }
+    
+    // Allocates the edge columns; offsets must already hold edges entries
+    bool allocateEdges(unsigned int edges) {
+        destination = new (nothrow) unsigned int[edges];
+        departureMins = new (nothrow) unsigned short[edges];
+        arrivalMins = new (nothrow) unsigned short[edges];
+        voyageCost = new (nothrow) unsigned int[edges];
+        voyageDay = new (nothrow) unsigned short[edges];
+        companyId = new (nothrow) unsigned short[edges];
+        route = new (nothrow) RouteNode*[edges];
+        if (edges > 0 && (!destination || !departureMins || !arrivalMins || !voyageCost ||
+                          !voyageDay || !companyId || !route)) {
+            clear();
+            return false;
+        }
+        edgeCount = edges;
+        return true;
+    }
+    
+    // Edges keep the order of each port's route list. Without growPort the
+    // arrays are packed; with it (a route was added to growPort and it had no
+    // free slot left) every port gets cancelled slots after its routes, so
+    // later additions anywhere fill those in place until one port runs out.
+    bool build(const Port* ports, unsigned int totalPorts, int growPort = -1) {
+        clear();
+        
+        offsets = new (nothrow) unsigned int[totalPorts + 1];
+        if (!offsets) return false;
+        
+        unsigned int edges = 0;
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            offsets[p] = edges;
+            unsigned int routes = 0;
+            for (RouteNode* r = ports[p].routeListHead; r; r = r->nextRoute) {
+                routes++;
+            }
+            edges += routes;
+            if (growPort != -1) {
+                unsigned int spare = routes >> ((int)p == growPort ? 1 : CSR_SPARE_SHIFT);
+                edges += spare > CSR_SPARE_SLOTS ? spare : CSR_SPARE_SLOTS;
+            }
+        }
+        offsets[totalPorts] = edges;
+        if (!allocateEdges(edges)) return false;
+        
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            unsigned int e = offsets[p];
+            for (RouteNode* r = ports[p].routeListHead; r; r = r->nextRoute, e++) {
+                destination[e] = r->destinationIndex;
+                departureMins[e] = r->departureMins;
+                arrivalMins[e] = r->arrivalMins;
+                voyageCost[e] = r->voyageCost;
+                voyageDay[e] = r->voyageDay;
+                companyId[e] = r->companyId;
+                route[e] = r;
+            }
+            for (; e < offsets[p + 1]; e++) {
+                destination[e] = p;
+                departureMins[e] = 0;
+                arrivalMins[e] = 0;
+                voyageCost[e] = 0;
+                voyageDay[e] = CANCELLED_DAY;
+                companyId[e] = 0;
+                route[e] = NULL;
+            }
+        }
+        
+        portCount = totalPorts;
+        return true;
+    }
+    
+    bool isBuilt() const { return offsets != NULL; }
+    
+    bool isCancelled(unsigned int e) const { return voyageDay[e] == CANCELLED_DAY; }
+    
+    unsigned int liveEdgeCount() const {
+        unsigned int live = 0;
+        for (unsigned int e = 0; e < edgeCount; e++) {
+            if (!isCancelled(e)) live++;
+        }
+        return live;
+    }
+    
+    // Incoming edges of each port: inEdges[inOffsets[p]..inOffsets[p + 1])
+    // are the ids of edges ending at p, in forward order
+    bool buildReverse() {
+        if (inOffsets) return true;
+        
+        inOffsets = new (nothrow) unsigned int[portCount + 1];
+        inEdges = new (nothrow) unsigned int[edgeCount];
+        if (!inOffsets || (edgeCount > 0 && !inEdges)) {
+            delete[] inOffsets;
+            delete[] inEdges;
+            inOffsets = NULL;
+            inEdges = NULL;
+            return false;
+        }
+        
+        for (unsigned int p = 0; p <= portCount; p++) {
+            inOffsets[p] = 0;
+        }
+        for (unsigned int e = 0; e < edgeCount; e++) {
+            inOffsets[destination[e] + 1]++;
+        }
+        for (unsigned int p = 0; p < portCount; p++) {
+            inOffsets[p + 1] += inOffsets[p];
+        }
+        
+        // Fill using each bucket's start as a cursor, then shift back
+        for (unsigned int e = 0; e < edgeCount; e++) {
+            inEdges[inOffsets[destination[e]]++] = e;
+        }
+        for (unsigned int p = portCount; p > 0; p--) {
+            inOffsets[p] = inOffsets[p - 1];
+        }
+        inOffsets[0] = 0;
+        return true;
+    }
+    
+    // Timetable view for the connection scan: every edge in order of
+    // departure minute, ties kept in adjacency order
+    bool buildDepartureOrder() {
+        if (byDeparture) return true;
+        
+        source = new (nothrow) unsigned int[edgeCount];
+        byDeparture = new (nothrow) int[edgeCount];
+        unsigned int* keys = new (nothrow) unsigned int[edgeCount];
+        if (edgeCount > 0 && (!source || !byDeparture || !keys)) {
+            delete[] keys;
+            delete[] source;
+            delete[] byDeparture;
+            source = NULL;
+            byDeparture = NULL;
+            return false;
+        }
+        
+        for (unsigned int p = 0; p < portCount; p++) {
+            for (unsigned int e = offsets[p]; e < offsets[p + 1]; e++) {
+                source[e] = p;
+                keys[e] = departureMinute(voyageDay[e], departureMins[e]);
+            }
+        }
+        bool sorted = sortIndicesByKey(keys, (int)edgeCount, byDeparture);
+        delete[] keys;
+        if (!sorted) {
+            delete[] source;
+            delete[] byDeparture;
+            source = NULL;
+            byDeparture = NULL;
+        }
+        return sorted;
+    }
+    
+    // Moves edge e, whose departure minute used to be oldKey, to its place
+    // in byDeparture for its current day and time. Equal minutes stay in
+    // edge order, as buildDepartureOrder leaves them.
+    void reorderDeparture(unsigned int e, unsigned int oldKey) {
+        if (!byDeparture) return;
+        
+        unsigned int lo = 0, hi = edgeCount, at = edgeCount;
+        while (lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            unsigned int f = (unsigned int)byDeparture[mid];
+            if (f == e) {
+                at = mid;
+                break;
+            }
+            unsigned int key = departureMinute(voyageDay[f], departureMins[f]);
+            if (key < oldKey || (key == oldKey && f < e)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (at == edgeCount) return;
+        memmove(byDeparture + at, byDeparture + at + 1, (edgeCount - at - 1) * sizeof(int));
+        
+        unsigned int newKey = departureMinute(voyageDay[e], departureMins[e]);
+        lo = 0;
+        hi = edgeCount - 1;
+        while (lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            unsigned int f = (unsigned int)byDeparture[mid];
+            unsigned int key = departureMinute(voyageDay[f], departureMins[f]);
+            if (key < newKey || (key == newKey && f < e)) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        memmove(byDeparture + lo + 1, byDeparture + lo, (edgeCount - 1 - lo) * sizeof(int));
+        byDeparture[lo] = (int)e;
+    }
+    
+    // Moves edge e, which used to end at oldDest, into its current
+    // target's group of inEdges, keeping each group in forward order
+    void regroupReverse(unsigned int e, unsigned int oldDest) {
+        unsigned int newDest = destination[e];
+        if (!inOffsets || newDest == oldDest) return;
+        
+        unsigned int at = inOffsets[oldDest];
+        while (at < inOffsets[oldDest + 1] && inEdges[at] != e) at++;
+        if (at == inOffsets[oldDest + 1]) return;
+        memmove(inEdges + at, inEdges + at + 1, (edgeCount - at - 1) * sizeof(unsigned int));
+        for (unsigned int p = oldDest + 1; p <= portCount; p++) {
+            inOffsets[p]--;
+        }
+        
+        at = inOffsets[newDest];
+        while (at < inOffsets[newDest + 1] && inEdges[at] < e) at++;
+        memmove(inEdges + at + 1, inEdges + at, (edgeCount - 1 - at) * sizeof(unsigned int));
+        inEdges[at] = e;
+        for (unsigned int p = newDest + 1; p <= portCount; p++) {
+            inOffsets[p]++;
+        }
+    }
+};
+
+// ---------------- FILE LOADING ----------------
+
+#define MAX_REPORTED_ERRORS 10
+
+// Read-only view of a whole file. Memory-mapped where the OS supports it,
+// otherwise read into a single heap buffer; either way fields are parsed
+// in place from this view without per-token copies.
+class MappedFile {
+private:
+    const char* data;
+    size_t length;
+    bool mapped;
+
+public:
+    MappedFile() : data(NULL), length(0), mapped(false) {}
+    
+    ~MappedFile() {
+        close();
+    }
+    
+    bool open(const char* path) {
+        close();
+#ifndef _WIN32
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            ::close(fd);
+            return false;
+        }
+        length = (size_t)info.st_size;
+        if (length > 0) {
+            void* view = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view == MAP_FAILED) {
+                ::close(fd);
+                length = 0;
+                return false;
+            }
+            madvise(view, length, MADV_SEQUENTIAL);
+            data = (const char*)view;
+            mapped = true;
+        }
+        ::close(fd);
+        return true;
+#else
+        ifstream file(path, ios::binary);
+        if (!file.is_open()) return false;
+        
+        file.seekg(0, ios::end);
+        length = (size_t)file.tellg();
+        file.seekg(0);
+        if (length > 0) {
+            char* buffer = new (nothrow) char[length];
+            if (!buffer || !file.read(buffer, length)) {
+                delete[] buffer;
+                length = 0;
+                return false;
+            }
+            data = buffer;
+        }
+        return true;
+#endif
+    }
+    
+    void close() {
+#ifndef _WIN32
+        if (mapped) munmap((void*)data, length);
+#endif
+        if (!mapped) delete[] data;
+        data = NULL;
+        length = 0;
+        mapped = false;
+    }
+    
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+    size_t size() const { return length; }
+};
+
+// A field inside a mapped line. Not NUL-terminated.
+struct Token {
+    const char* text;
+    int length;
+    int column;     // 1-based, for error reports
+};
+
+// Splits a mapped file into lines and each line into blank-separated tokens
+class LineTokenizer {
+private:
+    const char* pos;
+    const char* stop;
+    int lineNumber;
+
+public:
+    LineTokenizer(const char* begin, const char* end) 
+        : pos(begin), stop(end), lineNumber(0) {}
+    
+    // Tokenizes the next line, keeping at most maxTokens. Returns the number
+    // of tokens on the line (which may exceed maxTokens), or -1 at end of file.
+    int readLine(Token* tokens, int maxTokens) {
+        if (pos >= stop) return -1;
+        
+        const char* lineStart = pos;
+        int found = 0;
+        lineNumber++;
+        
+        while (pos < stop && *pos != '\n') {
+            if (*pos == ' ' || *pos == '\t' || *pos == '\r') {
+                pos++;
+                continue;
+            }
+            const char* start = pos;
+            while (pos < stop && *pos != ' ' && *pos != '\t' && *pos != '\r' && *pos != '\n') {
+                pos++;
+            }
+            if (found < maxTokens) {
+                tokens[found].text = start;
+                tokens[found].length = (int)(pos - start);
+                tokens[found].column = (int)(start - lineStart) + 1;
+            }
+            found++;
+        }
+        if (pos < stop) pos++;  // skip '\n'
+        return found;
+    }
+    
+    int getLineNumber() const { return lineNumber; }
+};
+
+// Signed decimal integer; rejects empty fields, stray characters and overflow
+bool parseIntField(const Token& token, int& value) {
+    const char* c = token.text;
+    const char* end = token.text + token.length;
+    bool negative = false;
+    
+    if (c < end && *c == '-') {
+        negative = true;
+        c++;
+    }
+    if (c == end) return false;
+    
+    long long result = 0;
+    for (; c < end; c++) {
+        if (*c < '0' || *c > '9') return false;
+        result = result * 10 + (*c - '0');
+        if (result > INT_MAX) return false;
+    }
+    value = negative ? (int)-result : (int)result;
+    return true;
+}
+
+// H:MM or HH:MM, converted to minutes after midnight
+bool parseTimeField(const Token& token, unsigned short& minutes) {
+    const char* t = token.text;
+    int hours, mins;
+    
+    if (token.length == 5 && t[2] == ':' && isdigit((unsigned char)t[0]) && 
+        isdigit((unsigned char)t[1])) {
+        hours = (t[0] - '0') * 10 + (t[1] - '0');
+        t += 3;
+    } else if (token.length == 4 && t[1] == ':' && isdigit((unsigned char)t[0])) {
+        hours = t[0] - '0';
+        t += 2;
+    } else {
+        return false;
+    }
+    if (!isdigit((unsigned char)t[0]) || !isdigit((unsigned char)t[1])) return false;
+    
+    mins = (t[0] - '0') * 10 + (t[1] - '0');
+    if (hours > 23 || mins > 59) return false;
+    minutes = (unsigned short)(hours * 60 + mins);
+    return true;
+}
+
+bool parseDateField(const Token& token, unsigned short& dayNumber) {
+    dayNumber = parseDayNumber(token.text, token.length);
+    return dayNumber != 0;
+}
+
+// Copies a token into a fixed buffer of the given size; false if it does not fit
+bool copyToken(const Token& token, char* dest, int destSize) {
+    if (token.length >= destSize) return false;
+    memcpy(dest, token.text, token.length);
+    dest[token.length] = '\0';
+    return true;
+}
+
+// Prints "file:line:column: message 'token'" for the first few bad rows
+void reportMalformed(const char* fileName, int line, const Token& token,
+                     const char* message, int& errorCount, ostream& out = cout) {
+    errorCount++;
+    if (errorCount > MAX_REPORTED_ERRORS) return;
+    
+    out << fileName << ":" << line << ":" << token.column << ": " << message << " '";
+    out.write(token.text, token.length);
+    out << "' - row skipped\n";
+}
+
+void reportMalformedSummary(const char* fileName, int errorCount, ostream& out = cout) {
+    if (errorCount > MAX_REPORTED_ERRORS) {
+        out << "... " << (errorCount - MAX_REPORTED_ERRORS) << " more malformed rows in "
+             << fileName << "\n";
+    }
+}
+
+// ---------------- PARALLEL ROUTE PARSING ----------------
+
+#define MIN_BYTES_PER_CHUNK (1 << 20)   // below this a file is parsed on one thread
+#define MAX_LOADER_THREADS 16
+
+// One Routes.txt row after parsing, still pointing into the mapped file
+struct ParsedRoute {
+    int line;               // line number within the chunk
+    int fromIdx;
+    int toIdx;
+    int cost;
+    unsigned short voyageDay;
+    unsigned short departureMins;
+    unsigned short arrivalMins;
+    Token company;
+    Token date;
+};
+
+struct ParseError {
+    int line;               // line number within the chunk
+    Token token;
+    const char* message;
+};
+
+// A newline-aligned slice of Routes.txt and everything parsed from it.
+// Each worker thread fills only its own chunk.
+class RouteChunk {
+private:
+    bool growRoutes() {
+        int newCapacity = routeCapacity ? routeCapacity * 2 : 256;
+        ParsedRoute* grown = new (nothrow) ParsedRoute[newCapacity];
+        if (!grown) return false;
+        for (int i = 0; i < routeCount; i++) {
+            grown[i] = routes[i];
+        }
+        delete[] routes;
+        routes = grown;
+        routeCapacity = newCapacity;
+        return true;
+    }
+    
+    bool growErrors() {
+        int newCapacity = errorCapacity ? errorCapacity * 2 : 16;
+        ParseError* grown = new (nothrow) ParseError[newCapacity];
+        if (!grown) return false;
+        for (int i = 0; i < errorCount; i++) {
+            grown[i] = errors[i];
+        }
+        delete[] errors;
+        errors = grown;
+        errorCapacity = newCapacity;
+        return true;
+    }
+
+public:
+    const char* begin;
+    const char* end;
+    ParsedRoute* routes;
+    int routeCount;
+    int routeCapacity;
+    ParseError* errors;
+    int errorCount;
+    int errorCapacity;
+    int lineCount;
+    bool outOfMemory;
+    
+    RouteChunk() : begin(NULL), end(NULL), routes(NULL), routeCount(0), routeCapacity(0),
+                   errors(NULL), errorCount(0), errorCapacity(0), lineCount(0),
+                   outOfMemory(false) {}
+    
+    ~RouteChunk() {
+        delete[] routes;
+        delete[] errors;
+    }
+    
+    ParsedRoute* addRoute() {
+        if (routeCount == routeCapacity && !growRoutes()) {
+            outOfMemory = true;
+            return NULL;
+        }
+        return &routes[routeCount++];
+    }
+    
+    void addError(int line, const Token& token, const char* message) {
+        if (errorCount == errorCapacity && !growErrors()) {
+            outOfMemory = true;
+            return;
+        }
+        errors[errorCount].line = line;
+        errors[errorCount].token = token;
+        errors[errorCount].message = message;
+        errorCount++;
+    }
+};
+
+// Parses one chunk. Only reads the port registry, so chunks can be parsed
+// concurrently; rows naming unknown ports or negative costs are dropped as
+// before, malformed rows are recorded for the caller to report in order.
+void parseRouteChunk(RouteChunk* chunk, const PortNameIndex* portLookup, const Port* ports) {
+    // Fields: origin dest date departure arrival cost company
+    const int ROUTE_FIELDS = 7;
+    Token fields[ROUTE_FIELDS + 1];     // one spare slot to catch extra fields
+    int count;
+    LineTokenizer lines(chunk->begin, chunk->end);
+    
+    while ((count = lines.readLine(fields, ROUTE_FIELDS + 1)) != -1 && !chunk->outOfMemory) {
+        if (count == 0) continue;
+        int line = lines.getLineNumber();
+        
+        if (count < ROUTE_FIELDS) {
+            chunk->addError(line, fields[count - 1], "missing fields after");
+            continue;
+        }
+        if (count > ROUTE_FIELDS) {
+            chunk->addError(line, fields[ROUTE_FIELDS], "unexpected extra field");
+            continue;
+        }
+        
+        unsigned short voyageDay, depMins, arrMins;
+        int cost;
+        if (!parseDateField(fields[2], voyageDay)) {
+            chunk->addError(line, fields[2], "invalid date");
+            continue;
+        }
+        if (!parseTimeField(fields[3], depMins)) {
+            chunk->addError(line, fields[3], "invalid departure time");
+            continue;
+        }
+        if (!parseTimeField(fields[4], arrMins)) {
+            chunk->addError(line, fields[4], "invalid arrival time");
+            continue;
+        }
+        if (!parseIntField(fields[5], cost)) {
+            chunk->addError(line, fields[5], "invalid cost");
+            continue;
+        }
+        if (fields[6].length >= MAX_COMPANY_LENGTH) {
+            chunk->addError(line, fields[6], "company name too long");
+            continue;
+        }
+        
+        int fromIdx = portLookup->find(fields[0].text, fields[0].length, ports);
+        int toIdx = portLookup->find(fields[1].text, fields[1].length, ports);
+        if (fromIdx == -1 || toIdx == -1 || cost < 0) continue;
+        
+        ParsedRoute* route = chunk->addRoute();
+        if (!route) break;
+        route->line = line;
+        route->fromIdx = fromIdx;
+        route->toIdx = toIdx;
+        route->cost = cost;
+        route->voyageDay = voyageDay;
+        route->departureMins = depMins;
+        route->arrivalMins = arrMins;
+        route->company = fields[6];
+        route->date = fields[2];
+    }
+    
+    chunk->lineCount = lines.getLineNumber();
+}
+
+// Splits [begin, end) into up to maxChunks slices that each end on a line
+// boundary. Returns the number of chunks filled.
+int splitIntoChunks(const char* begin, const char* end, RouteChunk* chunks, int maxChunks) {
+    size_t total = (size_t)(end - begin);
+    int used = 0;
+    const char* start = begin;
+    
+    while (start < end && used < maxChunks) {
+        const char* stop = end;
+        if (used < maxChunks - 1) {
+            size_t remaining = (size_t)(end - start);
+            size_t target = total / maxChunks;
+            if (target < remaining) {
+                const char* newline = (const char*)memchr(start + target, '\n', end - (start + target));
+                stop = newline ? newline + 1 : end;
+            }
+        }
+        chunks[used].begin = start;
+        chunks[used].end = stop;
+        used++;
+        start = stop;
+    }
+    return used;
+}
+
+// Worker threads for a file of this size: one per MIN_BYTES_PER_CHUNK, at
+// most one per core
+int chooseLoaderThreads(size_t fileSize) {
+    unsigned int cores = thread::hardware_concurrency();
+    if (cores == 0) cores = 1;
+    if (cores > MAX_LOADER_THREADS) cores = MAX_LOADER_THREADS;
+    
+    size_t bySize = fileSize / MIN_BYTES_PER_CHUNK;
+    if (bySize < 1) bySize = 1;
+    return (int)(bySize < cores ? bySize : cores);
+}
+
+// Worker threads for an all-pairs matrix: one per core, never more than rows
+int chooseMatrixThreads(unsigned int rows) {
+    unsigned int cores = thread::hardware_concurrency();
+    if (cores == 0) cores = 1;
+    if (cores > rows) cores = rows;
+    return cores ? (int)cores : 1;
+}
+
+// ---------------- BINARY SNAPSHOT ----------------
+// Network.snap holds everything loadPortCharges/loadRoutes produce: ports,
+// interned companies, the route adjacency, the landmark tables and the
+// post-simulation queues.
+// It is written once after a text load and mapped on later runs. Records are
+// stored in native byte order; a changed layout bumps SNAPSHOT_VERSION.
+
+#define SNAPSHOT_FILE "Network.snap"
+#define SELF_CHECK_SNAPSHOT_FILE "SelfCheck.snap"   // written and removed by the self-check
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_ENDIAN_MARK 0x01020304u
+
+// Size and modification time of a source file, to detect stale snapshots
+struct FileStamp {
+    long long size;     // -1 when the file does not exist
+    long long modified;
+};
+
+FileStamp stampFile(const char* path) {
+    FileStamp stamp;
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        stamp.size = -1;
+        stamp.modified = 0;
+    } else {
+        stamp.size = (long long)info.st_size;
+        stamp.modified = (long long)info.st_mtime;
+    }
+    return stamp;
+}
+
+bool sameStamp(const FileStamp& a, const FileStamp& b) {
+    return a.size == b.size && a.modified == b.modified;
+}
+
+struct SnapshotHeader {
+    char magic[8];
+    unsigned int version;
+    unsigned int endianMark;
+    unsigned int dockedShipCount;    // berth release times, over all ports
+    unsigned int portCount;
+    unsigned int companyCount;
+    unsigned int edgeCount;
+    unsigned int queuedShipCount;
+    unsigned int shipCount;          // ships fed to the arrival simulation
+    unsigned int arrivalsSimulated;
+    unsigned int landmarkCount;
+    FileStamp charges;
+    FileStamp routes;
+    unsigned long long payloadSize;
+    unsigned long long checksum;     // of the payload
+};
+
+// Followed by dockedCount release times, see BerthHeap
+struct SnapshotPort {
+    char portName[MAX_NAME_LENGTH];
+    unsigned short dailyDockingCharge;
+    unsigned short dockingSlots;
+    unsigned short dockedCount;
+    unsigned int queueLength;
+};
+
+struct SnapshotEdge {
+    unsigned int destination;
+    unsigned int voyageCost;
+    unsigned short voyageDay;
+    unsigned short departureMins;
+    unsigned short arrivalMins;
+    unsigned short companyId;
+};
+
+// A waiting ship. Port and company names are stored as ids.
+struct SnapshotShip {
+    char shipName[MAX_NAME_LENGTH];
+    char arrivalDate[MAX_DATE_LENGTH];
+    unsigned short arrivalDay;
+    unsigned short arrivalMins;
+    unsigned short companyId;
+    unsigned int originPort;
+    unsigned int serviceTimeNeeded;
+    unsigned int voyageCost;
+};
+
+// FNV-1a style mix over 64-bit words, then the trailing bytes
+unsigned long long checksumBytes(const char* data, size_t length) {
+    const unsigned long long prime = 1099511628211ULL;
+    unsigned long long hash = 14695981039346656037ULL;
+    size_t i = 0;
+    
+    for (; i + 8 <= length; i += 8) {
+        unsigned long long word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < length; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * prime;
+    }
+    return hash;
+}
+
+// Sequential reader over the snapshot payload; every read is bounds checked
+class SnapshotReader {
+private:
+    const char* cursor;
+    const char* end;
+
+public:
+    SnapshotReader(const char* begin, const char* stop) : cursor(begin), end(stop) {}
+    
+    bool read(void* dest, size_t bytes) {
+        if ((size_t)(end - cursor) < bytes) return false;
+        memcpy(dest, cursor, bytes);
+        cursor += bytes;
+        return true;
+    }
+    
+    bool atEnd() const { return cursor == end; }
+};
+
+// Sequential writer into a preallocated payload buffer
+class SnapshotWriter {
+private:
+    char* cursor;
+
+public:
+    SnapshotWriter(char* begin) : cursor(begin) {}
+    
+    void write(const void* src, size_t bytes) {
+        memcpy(cursor, src, bytes);
+        cursor += bytes;
+    }
+};
+
+// ---------------- LANDMARK (ALT) LOWER BOUNDS ----------------
+// For a landmark L, d(L, t) - d(L, v) and d(v, L) - d(t, L) are lower bounds
+// on d(v, t) by the triangle inequality. Distances use the voyage cost plus
+// the arrival port's queue penalty over every route, ignoring dates and
+// preferences; searches only remove routes from that (dates, filters), so
+// the bound stays admissible and consistent for all of them. The tables
+// must be rebuilt whenever the queue state behind the penalties changes.
+// A dearer or cancelled route leaves them valid (distances only grew); a
+// cheaper or new route is patched in by repairRoute.
+
+#define LANDMARK_COUNT 8
+#define UNREACHABLE UINT_MAX
+
+class LandmarkTable {
+private:
+    unsigned int count;
+    unsigned int portCount;
+    unsigned int* landmarks;
+    unsigned int* fromLandmark;     // [port * count + i] = d(landmark i, port)
+    unsigned int* toLandmark;       // [port * count + i] = d(port, landmark i)
+    
+    // Single-source costs from root over the forward or the reverse adjacency,
+    // written to table[port * count + slot]
+    static bool sweep(const RouteCSR& csr, const unsigned int* penalty, unsigned int root, 
+                      bool reverse, unsigned int* table, unsigned int count, unsigned int slot) {
+        PriorityQueue pq(csr.portCount);
+        if (!pq.isValid()) return false;
+        
+        for (unsigned int p = 0; p < csr.portCount; p++) {
+            table[p * count + slot] = UNREACHABLE;
+        }
+        table[root * count + slot] = 0;
+        pq.push(root, 0, 0);
+        settle(csr, penalty, reverse, table, count, slot, pq);
+        return true;
+    }
+    
+    // Dijkstra from whatever pq holds, lowering table entries that can be
+    // reached more cheaply. Returns the number of entries lowered.
+    static unsigned int settle(const RouteCSR& csr, const unsigned int* penalty, bool reverse,
+                               unsigned int* table, unsigned int count, unsigned int slot, 
+                               PriorityQueue& pq) {
+        unsigned int lowered = 0;
+        unsigned int port, cost, unused;
+        while (pq.pop(port, cost, unused)) {
+            if (cost > table[port * count + slot]) continue;
+            
+            unsigned int begin = reverse ? csr.inOffsets[port] : csr.offsets[port];
+            unsigned int end = reverse ? csr.inOffsets[port + 1] : csr.offsets[port + 1];
+            for (unsigned int k = begin; k < end; k++) {
+                unsigned int e = reverse ? csr.inEdges[k] : k;
+                if (csr.isCancelled(e)) continue;
+                unsigned int next = reverse ? csr.source[e] : csr.destination[e];
+                unsigned int step = csr.voyageCost[e] + penalty[csr.destination[e]];
+                if (cost > UNREACHABLE - 1 - step) continue;
+                
+                if (cost + step < table[next * count + slot]) {
+                    table[next * count + slot] = cost + step;
+                    pq.push(next, cost + step, 0);
+                    lowered++;
+                }
+            }
+        }
+        return lowered;
+    }
+
+public:
+    LandmarkTable() : count(0), portCount(0), landmarks(NULL), 
+                      fromLandmark(NULL), toLandmark(NULL) {}
+    
+    ~LandmarkTable() {
+        clear();
+    }
+    
+    void clear() {
+        delete[] landmarks;
+        delete[] fromLandmark;
+        delete[] toLandmark;
+        landmarks = NULL;
+        fromLandmark = NULL;
+        toLandmark = NULL;
+        count = 0;
+        portCount = 0;
+    }
+    
+    bool sameAs(const LandmarkTable& other) const {
+        if (count != other.count || portCount != other.portCount) return false;
+        if (count == 0) return true;
+        size_t cells = (size_t)portCount * count * sizeof(unsigned int);
+        return memcmp(landmarks, other.landmarks, count * sizeof(unsigned int)) == 0 &&
+               memcmp(fromLandmark, other.fromLandmark, cells) == 0 &&
+               memcmp(toLandmark, other.toLandmark, cells) == 0;
+    }
+    
+    // Picks landmarks by farthest-point selection: each new landmark is the
+    // port worst served by the ones chosen so far (unreachable ports first),
+    // which spreads them to the edges of the network. Needs the reverse view
+    // and edge sources on csr; penalty[p] is the queue cost of arriving at p.
+    bool build(const RouteCSR& csr, const unsigned int* penalty) {
+        clear();
+        unsigned int wanted = csr.portCount < LANDMARK_COUNT ? csr.portCount : LANDMARK_COUNT;
+        if (wanted == 0) return true;
+        
+        landmarks = new (nothrow) unsigned int[wanted];
+        fromLandmark = new (nothrow) unsigned int[(size_t)csr.portCount * wanted];
+        toLandmark = new (nothrow) unsigned int[(size_t)csr.portCount * wanted];
+        if (!landmarks || !fromLandmark || !toLandmark) {
+            clear();
+            return false;
+        }
+        
+        // Start from the port with the most departures
+        unsigned int next = 0;
+        for (unsigned int p = 1; p < csr.portCount; p++) {
+            if (csr.offsets[p + 1] - csr.offsets[p] > csr.offsets[next + 1] - csr.offsets[next]) {
+                next = p;
+            }
+        }
+        
+        for (unsigned int i = 0; i < wanted; i++) {
+            landmarks[i] = next;
+            if (!sweep(csr, penalty, next, false, fromLandmark, wanted, i) ||
+                !sweep(csr, penalty, next, true, toLandmark, wanted, i)) {
+                clear();
+                return false;
+            }
+            
+            // Farthest port from every chosen landmark, in either direction
+            unsigned int bestScore = 0;
+            bool found = false;
+            for (unsigned int p = 0; p < csr.portCount; p++) {
+                unsigned int score = UNREACHABLE;
+                bool chosen = false;
+                for (unsigned int j = 0; j <= i; j++) {
+                    if (landmarks[j] == p) chosen = true;
+                    unsigned int there = fromLandmark[(size_t)p * wanted + j];
+                    unsigned int back = toLandmark[(size_t)p * wanted + j];
+                    unsigned int nearest = there < back ? there : back;
+                    if (nearest < score) score = nearest;
+                }
+                if (!chosen && (!found || score > bestScore)) {
+                    bestScore = score;
+                    next = p;
+                    found = true;
+                }
+            }
+        }
+        
+        count = wanted;
+        portCount = csr.portCount;
+        return true;
+    }
+    
+    bool isBuilt() const { return landmarks != NULL; }
+    
+    unsigned int size() const { return count; }
+    
+    // Patches the tables after route e got cheaper or was added: wherever
+    // e now gives a shorter distance to or from a landmark, the new value
+    // is pushed on through the network. Only entries that actually drop
+    // are touched. Returns the number lowered, or -1 when out of memory
+    // (the tables are then cleared, A* falls back to Dijkstra order).
+    int repairRoute(const RouteCSR& csr, const unsigned int* penalty, unsigned int e) {
+        if (!landmarks || !csr.source || !csr.inOffsets || csr.portCount != portCount) return 0;
+        
+        PriorityQueue pq(portCount);
+        if (!pq.isValid()) {
+            clear();
+            return -1;
+        }
+        
+        unsigned int from = csr.source[e];
+        unsigned int to = csr.destination[e];
+        unsigned int step = csr.voyageCost[e] + penalty[to];
+        unsigned int lowered = 0;
+        
+        for (unsigned int i = 0; i < count; i++) {
+            // d(L, to) through from
+            unsigned int viaFrom = fromLandmark[(size_t)from * count + i];
+            if (viaFrom <= UNREACHABLE - 1 - step && 
+                viaFrom + step < fromLandmark[(size_t)to * count + i]) {
+                fromLandmark[(size_t)to * count + i] = viaFrom + step;
+                pq.push(to, viaFrom + step, 0);
+                lowered += 1 + settle(csr, penalty, false, fromLandmark, count, i, pq);
+            }
+            // d(from, L) through to
+            unsigned int viaTo = toLandmark[(size_t)to * count + i];
+            if (viaTo <= UNREACHABLE - 1 - step && 
+                viaTo + step < toLandmark[(size_t)from * count + i]) {
+                toLandmark[(size_t)from * count + i] = viaTo + step;
+                pq.push(from, viaTo + step, 0);
+                lowered += 1 + settle(csr, penalty, true, toLandmark, count, i, pq);
+            }
+        }
+        return (int)lowered;
+    }
+    
+    // Largest landmark bound on the cheapest cost from port to target
+    unsigned int lowerBound(unsigned int port, unsigned int target) const {
+        if (port >= portCount || target >= portCount) return 0;
+        
+        const unsigned int* fromV = fromLandmark + (size_t)port * count;
+        const unsigned int* fromT = fromLandmark + (size_t)target * count;
+        const unsigned int* toV = toLandmark + (size_t)port * count;
+        const unsigned int* toT = toLandmark + (size_t)target * count;
+        unsigned int best = 0;
+        
+        for (unsigned int i = 0; i < count; i++) {
+            // d(L, t) - d(L, v): only meaningful when v is reachable from L
+            if (fromV[i] != UNREACHABLE && fromT[i] != UNREACHABLE && fromT[i] > fromV[i]) {
+                if (fromT[i] - fromV[i] > best) best = fromT[i] - fromV[i];
+            }
+            // d(v, L) - d(t, L): only meaningful when L is reachable from t
+            if (toV[i] != UNREACHABLE && toT[i] != UNREACHABLE && toV[i] > toT[i]) {
+                if (toV[i] - toT[i] > best) best = toV[i] - toT[i];
+            }
+        }
+        return best;
+    }
+    
+    // Raw tables, for the snapshot
+    const unsigned int* landmarkPorts() const { return landmarks; }
+    const unsigned int* distancesFrom() const { return fromLandmark; }
+    const unsigned int* distancesTo() const { return toLandmark; }
+    
+    // Reads tables written from landmarkPorts/distancesFrom/distancesTo
+    bool restore(SnapshotReader& in, unsigned int landmarkCount, unsigned int ports) {
+        clear();
+        if (landmarkCount == 0) return true;
+        
+        landmarks = new (nothrow) unsigned int[landmarkCount];
+        fromLandmark = new (nothrow) unsigned int[(size_t)ports * landmarkCount];
+        toLandmark = new (nothrow) unsigned int[(size_t)ports * landmarkCount];
+        if (!landmarks || !fromLandmark || !toLandmark ||
+            !in.read(landmarks, landmarkCount * sizeof(unsigned int)) ||
+            !in.read(fromLandmark, (size_t)ports * landmarkCount * sizeof(unsigned int)) ||
+            !in.read(toLandmark, (size_t)ports * landmarkCount * sizeof(unsigned int))) {
+            clear();
+            return false;
+        }
+        count = landmarkCount;
+        portCount = ports;
+        return true;
+    }
+};
+
+// ---------------- CONTRACTION HIERARCHY ----------------
+// Optional preprocessing for unfiltered cheapest-route queries. Ports are
+// contracted one by one (least important first); contracting v adds a
+// shortcut u -> x whenever u -> v -> x is the only cheapest way between them.
+// A query then only climbs: forward from the source and backward from the
+// destination over arcs into higher-ranked ports, meeting at the top.
+// Weights match findCheapestRoute: voyage cost plus the arrival port's queue
+// penalty, with parallel routes collapsed to the cheapest (first on ties).
+
+#define CH_WITNESS_SETTLE_LIMIT 64   // ports settled per witness search
+#define CH_ESTIMATE_SETTLE_LIMIT 16  // ... when only rating a port
+#define CH_MAX_AVERAGE_DEGREE 32     // denser networks have no useful hierarchy
+#define CH_MAX_ARC_GROWTH 4          // give up past this many arcs per base arc
+
+struct CHArc {
+    unsigned int from;
+    unsigned int to;
+    unsigned int weight;
+    unsigned int bound; // weight when contracted; a lower bound once routes are raised
+    int edge;           // CSR edge of an original arc, -1 for a shortcut
+    int childA;         // shortcut halves: from -> middle ...
+    int childB;         // ... and middle -> to
+};
+
+// Growable list of arc ids
+struct ArcIdList {
+    unsigned int* ids;
+    unsigned int count;
+    unsigned int capacity;
+    
+    ArcIdList() : ids(NULL), count(0), capacity(0) {}
+    
+    ~ArcIdList() {
+        delete[] ids;
+    }
+    
+    bool push(unsigned int id) {
+        if (count == capacity) {
+            unsigned int newCapacity = capacity ? capacity * 2 : 4;
+            unsigned int* grown = new (nothrow) unsigned int[newCapacity];
+            if (!grown) return false;
+            for (unsigned int i = 0; i < count; i++) {
+                grown[i] = ids[i];
+            }
+            delete[] ids;
+            ids = grown;
+            capacity = newCapacity;
+        }
+        ids[count++] = id;
+        return true;
+    }
+    
+    void remove(unsigned int id) {
+        for (unsigned int i = 0; i < count; i++) {
+            if (ids[i] == id) {
+                ids[i] = ids[--count];
+                return;
+            }
+        }
+    }
+};
+
+class ContractionHierarchy {
+private:
+    CHArc* arcs;
+    unsigned int arcCount;
+    unsigned int arcCapacity;
+    unsigned int nodeCount;
+    unsigned int baseArcCount;
+    unsigned int* upOffsets;        // arcs v -> higher-ranked port, by v
+    unsigned int* upArcs;
+    unsigned int* downOffsets;      // arcs higher-ranked port -> v, by v
+    unsigned int* downArcs;
+    unsigned int* parentOffsets;    // shortcuts built over each arc, by arc
+    unsigned int* parentArcs;
+    unsigned short fromDay;         // routes sailing before this were left out
+    unsigned short earliestDay;     // first voyage day kept
+    unsigned short lastSkippedDay;  // last voyage day left out, 0 if none
+    bool raised;                    // some weight rose since contraction, see raiseRoute
+    
+    // Contraction-time state, freed once build() finishes
+    ArcIdList* outList;
+    ArcIdList* inList;
+    bool* contracted;
+    unsigned int* witnessDist;
+    unsigned int* witnessStamp;
+    unsigned int witnessGeneration;
+    
+    int addArc(unsigned int from, unsigned int to, unsigned int weight, 
+               int edge, int childA, int childB) {
+        if (arcCount == arcCapacity) {
+            unsigned int newCapacity = arcCapacity ? arcCapacity * 2 : 64;
+            CHArc* grown = new (nothrow) CHArc[newCapacity];
+            if (!grown) return -1;
+            for (unsigned int i = 0; i < arcCount; i++) {
+                grown[i] = arcs[i];
+            }
+            delete[] arcs;
+            arcs = grown;
+            arcCapacity = newCapacity;
+        }
+        
+        CHArc& arc = arcs[arcCount];
+        arc.from = from;
+        arc.to = to;
+        arc.weight = weight;
+        arc.bound = weight;
+        arc.edge = edge;
+        arc.childA = childA;
+        arc.childB = childB;
+        if (!outList[from].push(arcCount) || !inList[to].push(arcCount)) return -1;
+        return (int)arcCount++;
+    }
+    
+    unsigned int witnessCost(unsigned int port) const {
+        return (witnessStamp[port] == witnessGeneration) ? witnessDist[port] : UINT_MAX;
+    }
+    
+    // Bounded search from u over uncontracted ports, never through skip
+    void witnessSearch(PriorityQueue& pq, unsigned int u, unsigned int skip, unsigned int limit,
+                       unsigned int settleLimit) {
+        witnessGeneration++;
+        witnessStamp[u] = witnessGeneration;
+        witnessDist[u] = 0;
+        pq.push(u, 0, 0);
+        
+        unsigned int settled = 0, port, cost, unused;
+        while (pq.pop(port, cost, unused)) {
+            if (cost > limit || ++settled > settleLimit) break;
+            
+            const ArcIdList& out = outList[port];
+            for (unsigned int i = 0; i < out.count; i++) {
+                const CHArc& arc = arcs[out.ids[i]];
+                if (contracted[arc.to] || arc.to == skip) continue;
+                
+                unsigned int next = cost + arc.weight;
+                if (next < witnessCost(arc.to)) {
+                    witnessStamp[arc.to] = witnessGeneration;
+                    witnessDist[arc.to] = next;
+                    pq.push(arc.to, next, 0);
+                }
+            }
+        }
+        while (pq.pop(port, cost, unused)) {}   // leave the queue empty
+    }
+    
+    // Shortcuts needed to contract v; adds them unless simulating.
+    // Returns -1 if memory ran out.
+    int contract(PriorityQueue& pq, unsigned int v, bool simulate) {
+        int shortcuts = 0;
+        
+        for (unsigned int i = 0; i < inList[v].count; i++) {
+            unsigned int inArc = inList[v].ids[i];
+            unsigned int u = arcs[inArc].from;
+            if (contracted[u] || u == v) continue;
+            
+            unsigned int maxOut = 0;
+            bool anyOut = false;
+            for (unsigned int j = 0; j < outList[v].count; j++) {
+                const CHArc& out = arcs[outList[v].ids[j]];
+                if (contracted[out.to] || out.to == u || out.to == v) continue;
+                if (out.weight > maxOut) maxOut = out.weight;
+                anyOut = true;
+            }
+            if (!anyOut) continue;
+            
+            witnessSearch(pq, u, v, arcs[inArc].weight + maxOut,
+                          simulate ? CH_ESTIMATE_SETTLE_LIMIT : CH_WITNESS_SETTLE_LIMIT);
+            
+            for (unsigned int j = 0; j < outList[v].count; j++) {
+                unsigned int outArc = outList[v].ids[j];
+                unsigned int x = arcs[outArc].to;
+                if (contracted[x] || x == u || x == v) continue;
+                
+                unsigned int via = arcs[inArc].weight + arcs[outArc].weight;
+                if (witnessCost(x) <= via) continue;
+                
+                shortcuts++;
+                if (simulate) continue;
+                
+                // A shortcut replaces any dearer arc u -> x
+                for (unsigned int k = 0; k < outList[u].count; k++) {
+                    unsigned int old = outList[u].ids[k];
+                    if (arcs[old].to == x && arcs[old].weight > via) {
+                        outList[u].remove(old);
+                        inList[x].remove(old);
+                        break;
+                    }
+                }
+                if (addArc(u, x, via, -1, (int)inArc, (int)outArc) == -1) return -1;
+                
+                // Later witness searches from u see the new shortcut
+                witnessStamp[x] = witnessGeneration;
+                witnessDist[x] = via;
+            }
+        }
+        return shortcuts;
+    }
+    
+    // Arcs in the list whose other end is still uncontracted
+    unsigned int liveDegree(const ArcIdList& list, bool incoming) const {
+        unsigned int live = 0;
+        for (unsigned int i = 0; i < list.count; i++) {
+            const CHArc& arc = arcs[list.ids[i]];
+            if (!contracted[incoming ? arc.from : arc.to]) live++;
+        }
+        return live;
+    }
+    
+    // Edge difference plus contracted neighbours and hierarchy depth, offset
+    // to stay positive
+    unsigned int importance(PriorityQueue& pq, unsigned int v, const unsigned int* contractedNeighbours,
+                            const unsigned int* level) {
+        int added = contract(pq, v, true);
+        int removed = (int)(liveDegree(inList[v], true) + liveDegree(outList[v], false));
+        return (unsigned int)(2 * (added - removed) + (int)contractedNeighbours[v] + 
+                              (int)level[v] + (1 << 30));
+    }
+    
+    void freeContractionState() {
+        delete[] outList;
+        delete[] inList;
+        delete[] contracted;
+        delete[] witnessDist;
+        delete[] witnessStamp;
+        outList = NULL;
+        inList = NULL;
+        contracted = NULL;
+        witnessDist = NULL;
+        witnessStamp = NULL;
+    }
+    
+    // Groups the recorded (port, arc) pairs by port into offsets/list
+    static bool groupByPort(const unsigned int* owner, const unsigned int* ids, unsigned int count,
+                            unsigned int ports, unsigned int*& offsets, unsigned int*& list) {
+        offsets = new (nothrow) unsigned int[ports + 1];
+        list = new (nothrow) unsigned int[count + 1];
+        if (!offsets || !list) return false;
+        
+        for (unsigned int p = 0; p <= ports; p++) {
+            offsets[p] = 0;
+        }
+        for (unsigned int i = 0; i < count; i++) {
+            offsets[owner[i] + 1]++;
+        }
+        for (unsigned int p = 0; p < ports; p++) {
+            offsets[p + 1] += offsets[p];
+        }
+        for (unsigned int i = 0; i < count; i++) {
+            list[offsets[owner[i]]++] = ids[i];
+        }
+        for (unsigned int p = ports; p > 0; p--) {
+            offsets[p] = offsets[p - 1];
+        }
+        offsets[0] = 0;
+        return true;
+    }
+    
+    // Appends the CSR edges behind arc, in travel order
+    void unpack(unsigned int arc, unsigned int* edges, unsigned int& count, unsigned int maxEdges) const {
+        if (arcs[arc].edge >= 0) {
+            if (count < maxEdges) edges[count++] = (unsigned int)arcs[arc].edge;
+            return;
+        }
+        unpack((unsigned int)arcs[arc].childA, edges, count, maxEdges);
+        unpack((unsigned int)arcs[arc].childB, edges, count, maxEdges);
+    }
+    
+    static unsigned int addWeights(unsigned int a, unsigned int b) {
+        return (a == UINT_MAX || b == UINT_MAX || a > UINT_MAX - b) ? UINT_MAX : a + b;
+    }
+
+public:
+    ContractionHierarchy() : arcs(NULL), arcCount(0), arcCapacity(0), nodeCount(0), 
+                             baseArcCount(0), upOffsets(NULL), upArcs(NULL), 
+                             downOffsets(NULL), downArcs(NULL), parentOffsets(NULL),
+                             parentArcs(NULL), fromDay(0), earliestDay(0), lastSkippedDay(0),
+                             raised(false), outList(NULL),
+                             inList(NULL), contracted(NULL), witnessDist(NULL),
+                             witnessStamp(NULL), witnessGeneration(0) {}
+    
+    ~ContractionHierarchy() {
+        clear();
+    }
+    
+    void clear() {
+        freeContractionState();
+        delete[] arcs;
+        delete[] upOffsets;
+        delete[] upArcs;
+        delete[] downOffsets;
+        delete[] downArcs;
+        delete[] parentOffsets;
+        delete[] parentArcs;
+        arcs = NULL;
+        upOffsets = NULL;
+        upArcs = NULL;
+        downOffsets = NULL;
+        downArcs = NULL;
+        parentOffsets = NULL;
+        parentArcs = NULL;
+        arcCount = 0;
+        arcCapacity = 0;
+        nodeCount = 0;
+        baseArcCount = 0;
+        raised = false;
+    }
+    
+    bool isBuilt() const { return upOffsets != NULL; }
+    unsigned int getArcCount() const { return arcCount; }
+    unsigned int getShortcutCount() const { return arcCount - baseArcCount; }
+    unsigned short getFromDay() const { return fromDay; }
+    
+    // True if the routes sailing on or after day are exactly the ones the
+    // hierarchy was built over, i.e. no sailing lies between day and fromDay
+    bool covers(unsigned short day) const {
+        return isBuilt() && day > lastSkippedDay && day <= earliestDay;
+    }
+    
+    // Contracts the network of routes sailing on or after firstDay.
+    // penalty[p] is the queue cost of arriving at p. Returns false, leaving
+    // nothing built, if the network is too dense for a useful hierarchy or
+    // memory runs out.
+    bool build(const RouteCSR& csr, const unsigned int* penalty, unsigned short firstDay) {
+        clear();
+        unsigned int n = csr.portCount;
+        if (n == 0 || csr.edgeCount > (unsigned long long)n * CH_MAX_AVERAGE_DEGREE) return false;
+        
+        outList = new (nothrow) ArcIdList[n];
+        inList = new (nothrow) ArcIdList[n];
+        contracted = new (nothrow) bool[n];
+        witnessDist = new (nothrow) unsigned int[n];
+        witnessStamp = new (nothrow) unsigned int[n];
+        unsigned int* cheapest = new (nothrow) unsigned int[n];     // arc to each target
+        unsigned int* seenFrom = new (nothrow) unsigned int[n];     // ... for this source
+        unsigned int* contractedNeighbours = new (nothrow) unsigned int[n];
+        unsigned int* level = new (nothrow) unsigned int[n];
+        bool ok = outList && inList && contracted && witnessDist && witnessStamp &&
+                  cheapest && seenFrom && contractedNeighbours && level;
+        
+        for (unsigned int p = 0; ok && p < n; p++) {
+            contracted[p] = false;
+            witnessStamp[p] = 0;
+            seenFrom[p] = UINT_MAX;
+            contractedNeighbours[p] = 0;
+            level[p] = 0;
+        }
+        witnessGeneration = 0;
+        fromDay = firstDay;
+        earliestDay = USHRT_MAX;
+        lastSkippedDay = 0;
+        
+        // One arc per port pair: the cheapest route, first one on ties
+        for (unsigned int u = 0; ok && u < n; u++) {
+            for (unsigned int e = csr.offsets[u]; ok && e < csr.offsets[u + 1]; e++) {
+                if (csr.isCancelled(e)) continue;
+                unsigned int v = csr.destination[e];
+                if (csr.voyageDay[e] < fromDay) {
+                    if (csr.voyageDay[e] > lastSkippedDay) lastSkippedDay = csr.voyageDay[e];
+                    continue;
+                }
+                if (csr.voyageDay[e] < earliestDay) earliestDay = csr.voyageDay[e];
+                if (v == u) continue;
+                
+                unsigned int weight = csr.voyageCost[e] + penalty[v];
+                if (seenFrom[v] == u) {
+                    CHArc& arc = arcs[cheapest[v]];
+                    if (weight < arc.weight) {
+                        arc.weight = weight;
+                        arc.bound = weight;
+                        arc.edge = (int)e;
+                    }
+                    continue;
+                }
+                int id = addArc(u, v, weight, (int)e, -1, -1);
+                ok = (id != -1);
+                seenFrom[v] = u;
+                cheapest[v] = (unsigned int)id;
+            }
+        }
+        baseArcCount = arcCount;
+        delete[] cheapest;
+        delete[] seenFrom;
+        
+        // Arcs kept for the query, recorded at their lower-ranked end
+        ArcIdList upOwner, upIds, downOwner, downIds;
+        PriorityQueue order(n), witness(n);
+        ok = ok && order.isValid() && witness.isValid();
+        
+        for (unsigned int v = 0; ok && v < n; v++) {
+            order.push(v, importance(witness, v, contractedNeighbours, level), 0);
+        }
+        
+        unsigned int v, key, unused;
+        while (ok && order.pop(v, key, unused)) {
+            // Lazy update: re-rate v and defer it if it is no longer the least important
+            unsigned int current = importance(witness, v, contractedNeighbours, level);
+            if (!order.isEmpty() && current > order.topPriority()) {
+                order.push(v, current, 0);
+                continue;
+            }
+            
+            // The least important port already has a dense neighbourhood: the
+            // rest of the network would only fill in with shortcuts
+            ok = liveDegree(inList[v], true) * liveDegree(outList[v], false) <= 
+                 CH_MAX_AVERAGE_DEGREE * CH_MAX_AVERAGE_DEGREE;
+            
+            for (unsigned int i = 0; ok && i < outList[v].count; i++) {
+                unsigned int id = outList[v].ids[i];
+                if (contracted[arcs[id].to]) continue;
+                ok = upOwner.push(v) && upIds.push(id);
+            }
+            for (unsigned int i = 0; ok && i < inList[v].count; i++) {
+                unsigned int id = inList[v].ids[i];
+                if (contracted[arcs[id].from]) continue;
+                ok = downOwner.push(v) && downIds.push(id);
+            }
+            
+            ok = ok && contract(witness, v, false) != -1 &&
+                 arcCount <= baseArcCount * CH_MAX_ARC_GROWTH + n;
+            contracted[v] = true;
+            
+            // Neighbours gain a contracted neighbour and possibly depth; their new
+            // importance is picked up lazily when they reach the front
+            for (unsigned int side = 0; ok && side < 2; side++) {
+                const ArcIdList& list = side ? inList[v] : outList[v];
+                for (unsigned int i = 0; i < list.count; i++) {
+                    unsigned int x = side ? arcs[list.ids[i]].from : arcs[list.ids[i]].to;
+                    if (contracted[x]) continue;
+                    contractedNeighbours[x]++;
+                    if (level[x] < level[v] + 1) level[x] = level[v] + 1;
+                }
+            }
+        }
+        delete[] contractedNeighbours;
+        delete[] level;
+        
+        ok = ok && groupByPort(upOwner.ids, upIds.ids, upIds.count, n, upOffsets, upArcs) &&
+             groupByPort(downOwner.ids, downIds.ids, downIds.count, n, downOffsets, downArcs);
+        
+        // Each shortcut under both of its halves, for raiseRoute
+        ArcIdList childIds, parentIds;
+        for (unsigned int a = baseArcCount; ok && a < arcCount; a++) {
+            ok = childIds.push((unsigned int)arcs[a].childA) && parentIds.push(a) &&
+                 childIds.push((unsigned int)arcs[a].childB) && parentIds.push(a);
+        }
+        ok = ok && groupByPort(childIds.ids, parentIds.ids, parentIds.count, arcCount, 
+                               parentOffsets, parentArcs);
+        freeContractionState();
+        if (!ok) {
+            clear();
+            return false;
+        }
+        nodeCount = n;
+        return true;
+    }
+    
+    // Route e from port u was cancelled or got dearer. Its arc takes the
+    // cost of the cheapest route left between the two ports (UINT_MAX when
+    // none is) and every shortcut over it is re-added from its halves.
+    // Weights only rise, so paths through the hierarchy stay real and the
+    // contracted weights stay lower bounds, which query() uses to tell
+    // whether a path it found is still the cheapest. Returns false if
+    // memory ran out part way; the hierarchy must then be cleared.
+    bool raiseRoute(const RouteCSR& csr, const unsigned int* penalty, unsigned int u, 
+                    unsigned int e) {
+        if (!isBuilt() || u >= nodeCount) return true;
+        unsigned int v = csr.destination[e];
+        
+        // Original arcs were added port by port, so u's are a sorted run
+        unsigned int lo = 0, hi = baseArcCount;
+        while (lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            if (arcs[mid].from < u) lo = mid + 1;
+            else hi = mid;
+        }
+        while (lo < baseArcCount && arcs[lo].from == u && arcs[lo].to != v) lo++;
+        if (lo == baseArcCount || arcs[lo].from != u) return true;     // no arc, e.g. a self-loop
+        
+        CHArc& arc = arcs[lo];
+        unsigned int weight = UINT_MAX;
+        for (unsigned int k = csr.offsets[u]; k < csr.offsets[u + 1]; k++) {
+            if (csr.isCancelled(k) || csr.voyageDay[k] < fromDay || csr.destination[k] != v) continue;
+            if (csr.voyageCost[k] + penalty[v] < weight) {
+                weight = csr.voyageCost[k] + penalty[v];
+                arc.edge = (int)k;
+            }
+        }
+        if (weight == arc.weight) return true;
+        arc.weight = weight;
+        raised = true;
+        
+        ArcIdList pending;
+        if (!pending.push(lo)) return false;
+        while (pending.count > 0) {
+            unsigned int a = pending.ids[--pending.count];
+            for (unsigned int k = parentOffsets[a]; k < parentOffsets[a + 1]; k++) {
+                CHArc& shortcut = arcs[parentArcs[k]];
+                unsigned int sum = addWeights(arcs[shortcut.childA].weight, arcs[shortcut.childB].weight);
+                if (sum == shortcut.weight) continue;
+                shortcut.weight = sum;
+                if (!pending.push(parentArcs[k])) return false;
+            }
+        }
+        return true;
+    }
+    
+    // Cheapest cost from s to t (UINT_MAX if unreachable). Fills edges with
+    // the CSR edges of the path, source first, and settled with the number
+    // of ports taken off either frontier. The two frontiers keep their
+    // labels and heaps in the caller's scratches (minCost and viaEdge), so
+    // a query allocates nothing and, like the other searches, resets only
+    // the ports it touches. edges must not alias either scratch.
+    // Once routes have been raised the path may miss a cheaper one that a
+    // dropped witness used to cover, so a second climb over the contracted
+    // weights bounds the answer; exact is false unless the two agree.
+    unsigned int query(unsigned int s, unsigned int t, SearchScratch& fwd, SearchScratch& bwd,
+                       unsigned int* edges, unsigned int maxEdges, unsigned int& edgeCount,
+                       unsigned int& settled, bool& exact) const {
+        unsigned int cost = search(s, t, fwd, bwd, false, edges, maxEdges, edgeCount, settled);
+        exact = true;
+        if (raised) {
+            unsigned int boundLegs, boundSettled;
+            unsigned int bound = search(s, t, fwd, bwd, true, NULL, 0, boundLegs, boundSettled);
+            settled += boundSettled;
+            exact = (bound == cost);
+        }
+        return cost;
+    }
+
+private:
+    // One climb from both ends over the current weights, or the contracted
+    // ones when useBound
+    unsigned int search(unsigned int s, unsigned int t, SearchScratch& fwd, SearchScratch& bwd,
+                        bool useBound, unsigned int* edges, unsigned int maxEdges,
+                        unsigned int& edgeCount, unsigned int& settled) const {
+        edgeCount = 0;
+        settled = 0;
+        if (!isBuilt() || s >= nodeCount || t >= nodeCount) return UINT_MAX;
+        if (fwd.capacity < nodeCount || bwd.capacity < nodeCount) return UINT_MAX;
+        
+        unsigned int* distF = fwd.minCost;
+        unsigned int* distB = bwd.minCost;
+        int* parentF = fwd.viaEdge;
+        int* parentB = bwd.viaEdge;
+        PriorityQueue& forward = fwd.queue;
+        PriorityQueue& backward = bwd.queue;
+        unsigned int best = UINT_MAX;
+        int meet = -1;
+        
+        fwd.begin();
+        bwd.begin();
+        fwd.touch(s);
+        bwd.touch(t);
+        distF[s] = 0;
+        distB[t] = 0;
+        forward.push(s, 0, 0);
+        backward.push(t, 0, 0);
+        
+        while (true) {
+            unsigned int topF = forward.isEmpty() ? UINT_MAX : forward.topPriority();
+            unsigned int topB = backward.isEmpty() ? UINT_MAX : backward.topPriority();
+            if ((topF < topB ? topF : topB) >= best) break;
+            
+            bool goForward = topF <= topB;
+            SearchScratch& side = goForward ? fwd : bwd;
+            PriorityQueue& pq = side.queue;
+            unsigned int* dist = goForward ? distF : distB;
+            unsigned int* other = goForward ? distB : distF;
+            int* parent = goForward ? parentF : parentB;
+            const unsigned int* offsets = goForward ? upOffsets : downOffsets;
+            const unsigned int* list = goForward ? upArcs : downArcs;
+            
+            unsigned int port, cost, unused;
+            pq.pop(port, cost, unused);
+            fwd.touch(port);
+            bwd.touch(port);
+            settled++;
+            
+            if (other[port] != UINT_MAX && cost + other[port] < best) {
+                best = cost + other[port];
+                meet = (int)port;
+            }
+            
+            for (unsigned int k = offsets[port]; k < offsets[port + 1]; k++) {
+                const CHArc& arc = arcs[list[k]];
+                unsigned int weight = useBound ? arc.bound : arc.weight;
+                if (weight == UINT_MAX) continue;       // no route left behind it
+                unsigned int next = goForward ? arc.to : arc.from;
+                unsigned int nextCost = cost + weight;
+                side.touch(next);
+                if (nextCost < dist[next]) {
+                    dist[next] = nextCost;
+                    parent[next] = (int)list[k];
+                    pq.push(next, nextCost, 0);
+                }
+            }
+        }
+        
+        if (meet != -1) {
+            // Forward arcs are found meet-first; unpack them source-first
+            unsigned int hops = 0;
+            for (int p = meet; parentF[p] != -1; p = (int)arcs[parentF[p]].from) hops++;
+            for (unsigned int h = hops; h > 0; h--) {
+                int p = meet;
+                for (unsigned int k = 1; k < h; k++) p = (int)arcs[parentF[p]].from;
+                unpack((unsigned int)parentF[p], edges, edgeCount, maxEdges);
+            }
+            for (int p = meet; parentB[p] != -1; p = (int)arcs[parentB[p]].to) {
+                unpack((unsigned int)parentB[p], edges, edgeCount, maxEdges);
+            }
+        }
+        return best;
+    }
+};
+
+// ---------------- QUEUE WAIT TABLE ----------------
+// The port queues are simulation state that changes as ships arrive and
+// dock. Searches never read them directly: the owning thread publishes the
+// expected wait at every port here after each change, and searches read
+// only this table and the CSR. Any number of searches can therefore run at
+// once without locks, as long as nothing loads or simulates meanwhile.
+
+struct QueueWaitTable {
+    unsigned int* waitMinutes;  // expected wait for a ship arriving now
+    unsigned int* costPenalty;  // waitMinutes priced at the port's docking charge
+    unsigned int portCount;
+
+    QueueWaitTable() : waitMinutes(NULL), costPenalty(NULL), portCount(0) {}
+
+    ~QueueWaitTable() {
+        clear();
+    }
+
+    void clear() {
+        delete[] waitMinutes;
+        delete[] costPenalty;
+        waitMinutes = NULL;
+        costPenalty = NULL;
+        portCount = 0;
+    }
+
+    // Room for count ports, all with no wait; false (and empty) when out of memory
+    bool resize(unsigned int count) {
+        clear();
+        waitMinutes = new (nothrow) unsigned int[count + 1];
+        costPenalty = new (nothrow) unsigned int[count + 1];
+        if (!waitMinutes || !costPenalty) {
+            clear();
+            return false;
+        }
+        for (unsigned int p = 0; p <= count; p++) {
+            waitMinutes[p] = 0;
+            costPenalty[p] = 0;
+        }
+        portCount = count;
+        return true;
+    }
+
+    void set(unsigned int port, unsigned int minutes, unsigned short dailyCharge) {
+        if (port >= portCount) return;
+        waitMinutes[port] = minutes;
+        costPenalty[port] = (minutes / 60) * dailyCharge / 24;
+    }
+
+    unsigned int wait(unsigned int port) const {
+        return port < portCount ? waitMinutes[port] : 0;
+    }
+
+    unsigned int penalty(unsigned int port) const {
+        return port < portCount ? costPenalty[port] : 0;
+    }
+};
+
+// ---------------- DOCKING SIMULATION ----------------
+// Discrete-event replay of the schedule through the docking slots. Every
+// sailing is a ship arriving at its destination; arrivals, dock starts and
+// departures at all ports sit in one min-heap keyed on absolute minute, so
+// the queues evolve in true time order and each ship's wait is the exact
+// gap between arriving and docking, with no per-round estimate.
+
+#define EVENT_DEPARTURE 0  // within one minute slots are released first,
+#define EVENT_ARRIVAL 1    // then arriving ships claim a slot or queue,
+#define EVENT_DOCK 2       // then ships move into the slots they were given
+#define SIM_NO_SHIP UINT_MAX
+
+// Minute in the high bits, then event type, then ship index: one integer
+// compare orders events by time with a deterministic tie-break
+inline unsigned long long simEventKey(unsigned int minute, unsigned int type, 
+                                      unsigned int ship) {
+    return ((unsigned long long)minute << 34) | ((unsigned long long)type << 32) | ship;
+}
+
+// Plain d-ary min-heap of event keys. Each ship has at most one pending
+// event (it is either queued or waiting on exactly one), so the heap never
+// holds more entries than ships and is sized once.
+class EventHeap {
+private:
+    unsigned long long* keys;
+    unsigned int count;
+
+public:
+    EventHeap() : keys(NULL), count(0) {}
+
+    ~EventHeap() {
+        delete[] keys;
+    }
+
+    bool reserve(unsigned int capacity) {
+        delete[] keys;
+        count = 0;
+        keys = new (nothrow) unsigned long long[capacity ? capacity : 1];
+        return keys != NULL;
+    }
+
+    bool isEmpty() const {
+        return count == 0;
+    }
+
+    void push(unsigned long long key) {
+        unsigned int slot = count++;
+        while (slot > 0) {
+            unsigned int parent = (slot - 1) / PQ_ARITY;
+            if (keys[parent] <= key) break;
+            keys[slot] = keys[parent];
+            slot = parent;
+        }
+        keys[slot] = key;
+    }
+
+    unsigned long long pop() {
+        unsigned long long top = keys[0];
+        unsigned long long key = keys[--count];
+        unsigned int slot = 0;
+        while (true) {
+            unsigned int first = slot * PQ_ARITY + 1;
+            if (first >= count) break;
+            unsigned int last = first + PQ_ARITY;
+            if (last > count) last = count;
+
+            unsigned int best = first;
+            for (unsigned int c = first + 1; c < last; c++) {
+                if (keys[c] < keys[best]) best = c;
+            }
+            if (keys[best] >= key) break;
+            keys[slot] = keys[best];
+            slot = best;
+        }
+        keys[slot] = key;
+        return top;
+    }
+};
+
+// One ship as the simulator sees it
+struct SimShip {
+    unsigned int port;       // where it docks
+    unsigned int arrival;    // absolute minute, see arrivalMinute
+    unsigned int service;    // minutes alongside, see calculateServiceTime
+};
+
+class DockingSimulator {
+private:
+    EventHeap events;
+    unsigned int* nextWaiting;   // FIFO link between queued ships
+    unsigned int* queueHead;     // per port, SIM_NO_SHIP when empty
+    unsigned int* queueTail;
+    unsigned int* queueLength;
+    unsigned int* berthBase;     // portCount + 1 offsets into idleBerths
+    unsigned short* idleBerths;  // per port, a stack of its idle berth numbers
+    unsigned short* idleCount;
+
+    void release() {
+        delete[] nextWaiting;
+        delete[] queueHead;
+        delete[] queueTail;
+        delete[] queueLength;
+        delete[] berthBase;
+        delete[] idleBerths;
+        delete[] idleCount;
+        delete[] dockMinute;
+        delete[] departMinute;
+        delete[] berth;
+        delete[] queuePeak;
+        nextWaiting = queueHead = queueTail = queueLength = berthBase = NULL;
+        dockMinute = departMinute = queuePeak = NULL;
+        idleBerths = idleCount = berth = NULL;
+    }
+
+    // Ship s takes berth k and docks at minute
+    void assignBerth(unsigned int s, unsigned short k, unsigned int minute) {
+        berth[s] = k;
+        events.push(simEventKey(minute, EVENT_DOCK, s));
+    }
+
+public:
+    // Results, valid after run(): per ship...
+    unsigned int* dockMinute;
+    unsigned int* departMinute;
+    unsigned short* berth;       // which of its port's berths it used
+    // ...and per port
+    unsigned int* queuePeak;     // most ships ever waiting at once
+    unsigned long long eventsProcessed;
+
+    DockingSimulator() : nextWaiting(NULL), queueHead(NULL), queueTail(NULL), 
+                         queueLength(NULL), berthBase(NULL), idleBerths(NULL), 
+                         idleCount(NULL), dockMinute(NULL), departMinute(NULL), 
+                         berth(NULL), queuePeak(NULL), eventsProcessed(0) {}
+
+    ~DockingSimulator() {
+        release();
+    }
+
+    // Replays every ship to departure through berths[p] berths at each
+    // port. Ships arriving in the same minute queue in index order.
+    // False if out of memory.
+    bool run(const SimShip* ships, unsigned int shipCount, 
+             const unsigned short* berths, unsigned int portCount) {
+        release();
+        eventsProcessed = 0;
+        berthBase = new (nothrow) unsigned int[portCount + 1];
+        if (!berthBase) return false;
+        berthBase[0] = 0;
+        for (unsigned int p = 0; p < portCount; p++) {
+            berthBase[p + 1] = berthBase[p] + berths[p];
+        }
+        
+        nextWaiting = new (nothrow) unsigned int[shipCount + 1];
+        dockMinute = new (nothrow) unsigned int[shipCount + 1];
+        departMinute = new (nothrow) unsigned int[shipCount + 1];
+        berth = new (nothrow) unsigned short[shipCount + 1];
+        queueHead = new (nothrow) unsigned int[portCount + 1];
+        queueTail = new (nothrow) unsigned int[portCount + 1];
+        queueLength = new (nothrow) unsigned int[portCount + 1];
+        queuePeak = new (nothrow) unsigned int[portCount + 1];
+        idleCount = new (nothrow) unsigned short[portCount + 1];
+        idleBerths = new (nothrow) unsigned short[berthBase[portCount] + 1];
+        if (!nextWaiting || !dockMinute || !departMinute || !berth || !queueHead || 
+            !queueTail || !queueLength || !queuePeak || !idleCount || !idleBerths || 
+            !events.reserve(shipCount)) {
+            release();
+            return false;
+        }
+        for (unsigned int p = 0; p < portCount; p++) {
+            queueHead[p] = queueTail[p] = SIM_NO_SHIP;
+            queueLength[p] = queuePeak[p] = 0;
+            idleCount[p] = berths[p];
+            for (unsigned short k = 0; k < berths[p]; k++) {
+                idleBerths[berthBase[p] + k] = (unsigned short)(berths[p] - 1 - k);
+            }
+        }
+        for (unsigned int s = 0; s < shipCount; s++) {
+            events.push(simEventKey(ships[s].arrival, EVENT_ARRIVAL, s));
+        }
+
+        while (!events.isEmpty()) {
+            unsigned long long key = events.pop();
+            unsigned int minute = (unsigned int)(key >> 34);
+            unsigned int type = (unsigned int)(key >> 32) & 3;
+            unsigned int s = (unsigned int)key;
+            unsigned int p = ships[s].port;
+            unsigned short* idle = idleBerths + berthBase[p];
+            eventsProcessed++;
+
+            if (type == EVENT_ARRIVAL) {
+                if (idleCount[p] > 0) {
+                    assignBerth(s, idle[--idleCount[p]], minute);
+                    continue;
+                }
+                nextWaiting[s] = SIM_NO_SHIP;
+                if (queueTail[p] == SIM_NO_SHIP) {
+                    queueHead[p] = s;
+                } else {
+                    nextWaiting[queueTail[p]] = s;
+                }
+                queueTail[p] = s;
+                if (++queueLength[p] > queuePeak[p]) queuePeak[p] = queueLength[p];
+            } else if (type == EVENT_DOCK) {
+                dockMinute[s] = minute;
+                events.push(simEventKey(minute + ships[s].service, EVENT_DEPARTURE, s));
+            } else {
+                departMinute[s] = minute;
+                unsigned int next = queueHead[p];
+                if (next == SIM_NO_SHIP) {
+                    idle[idleCount[p]++] = berth[s];
+                    continue;
+                }
+                queueHead[p] = nextWaiting[next];
+                if (queueHead[p] == SIM_NO_SHIP) queueTail[p] = SIM_NO_SHIP;
+                queueLength[p]--;
+                assignBerth(next, berth[s], minute);
+            }
+        }
+        return true;
+    }
+};
+
+// ---------------- ROUTE CACHE ----------------
+// Bounded LRU of cheapest-route answers for popular lanes. Entries are keyed
+// on source, destination, day, algorithm and preference fields, and tagged
+// with the network generation they were computed under: a lookup under any
+// other generation empties the cache first. Not thread-safe; it serves the
+// interactive findCheapestRoute only.
+
+#define ROUTE_CACHE_CAPACITY 256
+#define ROUTE_CACHE_BUCKETS 512     // power of two, at least the capacity
+
+struct RouteCacheEntry {
+    int srcIdx;
+    int destIdx;
+    unsigned short day;
+    int algorithm;
+    bool hasPrefs;
+    UserPreferences prefs;
+    unsigned int hash;
+    RouteResult result;         // path and legs point at the buffers below
+    unsigned int* path;
+    RouteNode** legs;
+    unsigned int pathCapacity;
+    int prev;                   // LRU neighbours, most recent first
+    int next;
+    int nextInBucket;
+};
+
+class RouteCache {
+private:
+    RouteCacheEntry entries[ROUTE_CACHE_CAPACITY];
+    int buckets[ROUTE_CACHE_BUCKETS];
+    int used;
+    int head;
+    int tail;
+    unsigned int generation;
+    unsigned long long hits;
+    unsigned long long misses;
+    
+    static unsigned int keyHash(int srcIdx, int destIdx, unsigned short day, int algorithm,
+                                const UserPreferences* prefs) {
+        const unsigned int words[5] = { (unsigned int)srcIdx, (unsigned int)destIdx, day,
+                                        (unsigned int)algorithm, preferencesHash(prefs) };
+        unsigned int h = 2166136261u;
+        for (int i = 0; i < 5; i++) {
+            h = (h ^ words[i]) * 16777619u;
+        }
+        return h;
+    }
+    
+    int lookup(unsigned int hash, int srcIdx, int destIdx, unsigned short day, int algorithm,
+               const UserPreferences* prefs) const {
+        for (int i = buckets[hash & (ROUTE_CACHE_BUCKETS - 1)]; i != -1; i = entries[i].nextInBucket) {
+            const RouteCacheEntry& e = entries[i];
+            if (e.hash == hash && e.srcIdx == srcIdx && e.destIdx == destIdx && e.day == day &&
+                e.algorithm == algorithm && samePreferences(e.hasPrefs ? &e.prefs : NULL, prefs)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+    
+    void unlink(int i) {
+        if (entries[i].prev != -1) entries[entries[i].prev].next = entries[i].next;
+        else head = entries[i].next;
+        if (entries[i].next != -1) entries[entries[i].next].prev = entries[i].prev;
+        else tail = entries[i].prev;
+    }
+    
+    void pushFront(int i) {
+        entries[i].prev = -1;
+        entries[i].next = head;
+        if (head != -1) entries[head].prev = i;
+        head = i;
+        if (tail == -1) tail = i;
+    }
+    
+    void removeFromBucket(int i) {
+        int* link = &buckets[entries[i].hash & (ROUTE_CACHE_BUCKETS - 1)];
+        while (*link != i) {
+            link = &entries[*link].nextInBucket;
+        }
+        *link = entries[i].nextInBucket;
+    }
+    
+    // Drops everything cached under an older network
+    void sync(unsigned int networkGeneration) {
+        if (networkGeneration != generation) {
+            clear();
+            generation = networkGeneration;
+        }
+    }
+
+public:
+    RouteCache() : used(0), head(-1), tail(-1), generation(0), hits(0), misses(0) {
+        for (int i = 0; i < ROUTE_CACHE_CAPACITY; i++) {
+            entries[i].path = NULL;
+            entries[i].legs = NULL;
+            entries[i].pathCapacity = 0;
+        }
+        clear();
+    }
+    
+    ~RouteCache() {
+        for (int i = 0; i < ROUTE_CACHE_CAPACITY; i++) {
+            delete[] entries[i].path;
+            delete[] entries[i].legs;
+        }
+    }
+    
+    // Forgets all answers; path buffers are kept for reuse
+    void clear() {
+        for (int b = 0; b < ROUTE_CACHE_BUCKETS; b++) {
+            buckets[b] = -1;
+        }
+        used = 0;
+        head = -1;
+        tail = -1;
+    }
+    
+    // Cached answer for the request, or NULL. A hit becomes most recent.
+    const RouteResult* find(int srcIdx, int destIdx, unsigned short day, int algorithm,
+                            const UserPreferences* prefs, unsigned int networkGeneration) {
+        sync(networkGeneration);
+        int i = lookup(keyHash(srcIdx, destIdx, day, algorithm, prefs), 
+                       srcIdx, destIdx, day, algorithm, prefs);
+        if (i == -1) {
+            misses++;
+            return NULL;
+        }
+        hits++;
+        unlink(i);
+        pushFront(i);
+        return &entries[i].result;
+    }
+    
+    // Copies result, path included, evicting the least recently used answer
+    // when full. False if the path copy could not be allocated.
+    bool store(int srcIdx, int destIdx, unsigned short day, int algorithm,
+               const UserPreferences* prefs, unsigned int networkGeneration,
+               const RouteResult& result) {
+        sync(networkGeneration);
+        unsigned int hash = keyHash(srcIdx, destIdx, day, algorithm, prefs);
+        int i = lookup(hash, srcIdx, destIdx, day, algorithm, prefs);
+        bool fresh = (i == -1);
+        if (fresh) i = (used < ROUTE_CACHE_CAPACITY) ? used : tail;
+        
+        RouteCacheEntry& e = entries[i];
+        if (result.portCount > e.pathCapacity) {
+            unsigned int* path = new (nothrow) unsigned int[result.portCount];
+            RouteNode** legs = new (nothrow) RouteNode*[result.portCount];
+            if (!path || !legs) {
+                delete[] path;
+                delete[] legs;
+                return false;
+            }
+            delete[] e.path;
+            delete[] e.legs;
+            e.path = path;
+            e.legs = legs;
+            e.pathCapacity = result.portCount;
+        }
+        
+        if (fresh && i == used) {
+            used++;
+        } else {
+            removeFromBucket(i);
+            unlink(i);
+        }
+        
+        e.srcIdx = srcIdx;
+        e.destIdx = destIdx;
+        e.day = day;
+        e.algorithm = algorithm;
+        e.hasPrefs = (prefs != NULL);
+        if (prefs) e.prefs = *prefs;
+        e.hash = hash;
+        e.result = result;
+        for (unsigned int k = 0; k < result.portCount; k++) {
+            e.path[k] = result.path[k];
+            e.legs[k] = result.legs[k];
+        }
+        e.result.path = e.path;
+        e.result.legs = e.legs;
+        
+        int& bucket = buckets[hash & (ROUTE_CACHE_BUCKETS - 1)];
+        e.nextInBucket = bucket;
+        bucket = i;
+        pushFront(i);
+        return true;
+    }
+    
+    unsigned long long getHits() const { return hits; }
+    unsigned long long getMisses() const { return misses; }
+    int size() const { return used; }
+};
+
+// ---------------- GRAPH CLASS ----------------
+class Graph {
+private:
+    Port* ports;                 // growable port registry
+    unsigned int totalPorts;
+    unsigned int portCapacity;
+    PortNameIndex portLookup;    // name -> index hash table
+    NameTable companies;         // interned shipping company names
+    RouteCSR csr;                // frozen adjacency used by the searches
+    QueueWaitTable queueWaits;   // port queue waits as the searches see them
+    LandmarkTable landmarks;     // A* lower bounds over csr
+    ContractionHierarchy hierarchy;  // optional, see buildContractionHierarchy
+    unsigned int arrivalsSimulated;  // ships fed through simulateShipArrival
+    unsigned int scheduledShips;     // ships offered to the arrival simulation
+    RouteCache routeCache;           // recent findCheapestRoute answers
+    unsigned int networkGeneration;  // bumped whenever routes or queues change
+    ostream* log;                    // where load progress and file errors go
+    
+    // Anything a cached route answer depends on has changed
+    void markNetworkChanged() {
+        networkGeneration++;
+    }
+    
+    // Lower bound on the remaining voyage cost; 0 (plain Dijkstra order)
+    // when the landmark tables are missing
+    unsigned int calculateHeuristic(unsigned int fromPort, unsigned int toPort) const {
+        if (fromPort == toPort) return 0;
+        return landmarks.lowerBound(fromPort, toPort);
+    }
+    
+    // Indexes derived from the final CSR: timetable order, reverse view and
+    // landmark distances. Searches fall back gracefully without them.
+    void buildSearchIndexes() {
+        if (!queueWaits.costPenalty || !csr.buildDepartureOrder() || !csr.buildReverse() ||
+            !landmarks.build(csr, queueWaits.costPenalty)) {
+            *log << "Warning: Not enough memory for route search indexes\n";
+        }
+    }
+    
+    // Resolves company and port names in prefs (may be NULL) to ids once per search
+    RouteFilter resolvePreferences(const UserPreferences* prefs) const {
+        RouteFilter filter;
+        if (!prefs) return filter;
+        
+        if (prefs->hasCompanyFilter) {
+            filter.hasCompanyFilter = true;
+            filter.companyId = companies.find(prefs->preferredCompany);
+        }
+        if (prefs->hasAvoidPort) {
+            filter.avoidPortIdx = getPortIndex(prefs->avoidPort);
+        }
+        if (prefs->hasMaxCostLimit) {
+            filter.hasMaxCostLimit = true;
+            filter.maxCostLimit = prefs->maxCostLimit;
+        }
+        return filter;
+    }
+    
+    bool matchesPreferences(const RouteNode* route, const RouteFilter& filter) const {
+        if (!route) return false;
+        return filter.passes(route->destinationIndex, route->voyageCost, route->companyId);
+    }
+    
+    bool hasValidDirectRoute(int srcIdx, int destIdx, const char* date, 
+                            const UserPreferences* prefs) const {
+        if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx) || !isValidDate(date)) return false;
+        
+        RouteFilter filter = resolvePreferences(prefs);
+        unsigned short fromDay = dateToDayNumber(date);
+        RouteNode* route = ports[srcIdx].routeListHead;
+        
+        while (route) {
+            if (route->destinationIndex == (unsigned int)destIdx) {
+                if (route->voyageDay >= fromDay) {
+                    if (prefs) {
+                        if (!matchesPreferences(route, filter)) {
+                            route = route->nextRoute;
+                            continue;
+                        }
+                    }
+                    return true;
+                }
+            }
+            route = route->nextRoute;
+        }
+        
+        return false;
+    }
+    
+    // Wait for a ship joining a port's queue right after its last simulated
+    // arrival: the time until the berth that frees first, once every ship
+    // already queued has been served
+    unsigned int calculateQueueWaitTime(int portIdx) const {
+        if (!isValidPortIndex(portIdx)) return 0;
+        return ports[portIdx].berthsFree->earliest();
+    }
+    
+    // Republish one port's queue wait after its queue changed
+    // (a no-op until the table is sized, so loading stays linear)
+    void publishQueueWait(unsigned int portIdx) {
+        if (portIdx >= queueWaits.portCount) return;
+        queueWaits.set(portIdx, calculateQueueWaitTime(portIdx), 
+                       ports[portIdx].dailyDockingCharge);
+    }
+    
+    // Republish every port's queue wait, e.g. after a reload
+    void publishQueueWaits() {
+        if (!queueWaits.resize(totalPorts)) {
+            *log << "Warning: Not enough memory for queue wait table\n";
+            return;
+        }
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            publishQueueWait(p);
+        }
+    }
+    
+    // Edge id of the live route src -> dest leaving on day at depMins with
+    // the given company, or -1
+    int findRouteEdge(unsigned int src, unsigned int dest, unsigned short day,
+                      unsigned short depMins, int companyId) const {
+        if (companyId < 0 || !csr.isBuilt() || src >= csr.portCount) return -1;
+        for (unsigned int e = csr.offsets[src]; e < csr.offsets[src + 1]; e++) {
+            if (csr.destination[e] == dest && csr.voyageDay[e] == day && 
+                csr.departureMins[e] == depMins && csr.companyId[e] == companyId && 
+                !csr.isCancelled(e)) {
+                return (int)e;
+            }
+        }
+        return -1;
+    }
+    
+    void unlinkRoute(unsigned int src, RouteNode* node) {
+        RouteNode* prev = NULL;
+        for (RouteNode* r = ports[src].routeListHead; r; prev = r, r = r->nextRoute) {
+            if (r != node) continue;
+            if (prev) {
+                prev->nextRoute = r->nextRoute;
+            } else {
+                ports[src].routeListHead = r->nextRoute;
+            }
+            if (ports[src].routeListTail == r) {
+                ports[src].routeListTail = prev;
+            }
+            return;
+        }
+    }
+    
+    // Route e got cheaper or was added: patch the landmark bounds over it
+    void repairBounds(unsigned int e) {
+        if (!queueWaits.costPenalty) return;
+        if (landmarks.repairRoute(csr, queueWaits.costPenalty, e) == -1) {
+            *log << "Warning: Not enough memory to repair landmark bounds\n";
+        }
+    }
+    
+    // After a route is added or gets cheaper. Cached answers are dropped
+    // lazily with the generation; a cheaper route can undercut the
+    // hierarchy's shortcuts and witnesses, which cannot be patched, so it goes.
+    void routesChanged() {
+        markNetworkChanged();
+        hierarchy.clear();
+    }
+    
+    // After route e from src is cancelled or gets dearer. The hierarchy only
+    // raises the arcs built on it (see ContractionHierarchy::raiseRoute).
+    void routeRaised(unsigned int src, unsigned int e) {
+        markNetworkChanged();
+        if (queueWaits.costPenalty && !hierarchy.raiseRoute(csr, queueWaits.costPenalty, src, e)) {
+            *log << "Warning: Not enough memory to update the contraction hierarchy\n";
+            hierarchy.clear();
+        }
+    }
+    
+    // Empty queue and idle berths for a newly registered port
+    void initPortQueue(Port& port, unsigned short berths) {
+        port.waitingQueue = new ShipQueue();
+        port.dockingSlots = berths;
+        port.dockedShips = new BerthHeap(berths);
+        port.berthsFree = new BerthHeap(berths);
+        port.lastArrival = 0;
+    }
+    
+    // Ship joins the back of the queue; the berth that frees first after
+    // the ships ahead of it is the one it will take
+    void queueShip(Port& port, const Ship& ship) {
+        port.waitingQueue->enqueue(ship);
+        port.berthsFree->replaceEarliest(port.berthsFree->earliest() + ship.serviceTimeNeeded);
+    }
+    
+    // Moves a port's clock on by minutes: ships whose service ends by then
+    // leave, and the head of the queue takes each berth the moment it frees
+    void advancePortClock(Port& port, unsigned int minutes) {
+        BerthHeap& docked = *port.dockedShips;
+        while (docked.size() > 0 && docked.top() <= minutes) {
+            Ship next;
+            if (port.waitingQueue->dequeue(next)) {
+                docked.replaceEarliest(docked.top() + next.serviceTimeNeeded);
+            } else {
+                // Nobody waits, so the berths free exactly when the docked ships leave
+                docked.pop();
+                port.berthsFree->pop();
+            }
+        }
+        docked.elapse(minutes);
+        port.berthsFree->elapse(minutes);
+    }
+    
+    // Simulate ship arrival and queue management. Ships must arrive in
+    // time order: the port's queue first drains up to this arrival.
+    void simulateShipArrival(int portIdx, const Ship& ship) {
+        if (!isValidPortIndex(portIdx)) return;
+        arrivalsSimulated++;
+        markNetworkChanged();
+        
+        Port& port = ports[portIdx];
+        unsigned int now = shipArrivalKey(ship);
+        if (now > port.lastArrival) {
+            advancePortClock(port, now - port.lastArrival);
+            port.lastArrival = now;
+        }
+        if (!port.dockedShips->isFull()) {
+            // Berth available, dock immediately
+            port.dockedShips->push(ship.serviceTimeNeeded);
+            port.berthsFree->push(ship.serviceTimeNeeded);
+        } else {
+            // All berths occupied, add to queue
+            queueShip(port, ship);
+        }
+        publishQueueWait(portIdx);
+    }
+    
+    // Grow the port registry so it can hold at least 'needed' ports
+    bool ensurePortCapacity(unsigned int needed) {
+        if (needed <= portCapacity) return true;
+        
+        unsigned int newCapacity = portCapacity ? portCapacity : INITIAL_PORT_CAPACITY;
+        while (newCapacity < needed) {
+            newCapacity *= 2;
+        }
+        
+        Port* grown = new (nothrow) Port[newCapacity];
+        if (!grown) return false;
+        
+        for (unsigned int i = 0; i < totalPorts; i++) {
+            grown[i] = ports[i];
+        }
+        delete[] ports;
+        ports = grown;
+        portCapacity = newCapacity;
+        return true;
+    }
+    
+    void displayPreferences(const UserPreferences* prefs) const {
+        if (!prefs || !prefs->hasAnyFilter()) return;
+        
+        if (prefs->hasCompanyFilter) {
+            cout << "Company Filter: " << prefs->preferredCompany << "\n";
+        }
+        if (prefs->hasAvoidPort) {
+            cout << "Avoiding Port: " << prefs->avoidPort << "\n";
+        }
+        if (prefs->hasMaxCostLimit) {
+            cout << "Max Cost Limit: $" << prefs->maxCostLimit << "\n";
+        }
+        if (prefs->hasMaxTimeLimit) {
+            cout << "Max Time Limit: " << prefs->maxTimeLimit << " hours\n";
+        }
+    }
+    
+    // Prompts for source, destination and date; false if a port is unknown
+    bool readRouteQuery(const char* title, int& si, int& di, char* date) {
+        char src[MAX_NAME_LENGTH], dst[MAX_NAME_LENGTH];
+        
+        cout << "\n--- " << title << " ---\n";
+        cout << "Ports: ";
+        for (unsigned int i = 0; i < totalPorts; i++) {
+            cout << ports[i].portName;
+            if (i < totalPorts - 1) cout << ", ";
+        }
+        cout << "\n\n";
+        
+        cout << "Source: ";
+        cin >> src;
+        cout << "Destination: ";
+        cin >> dst;
+        cout << "Date (DD/MM/YYYY): ";
+        cin >> date;
+        
+        si = getPortIndex(src);
+        di = getPortIndex(dst);
+        
+        if (si == -1) {
+            cout << "❌ Source port '" << src << "' not found!\n";
+            return false;
+        }
+        if (di == -1) {
+            cout << "❌ Destination port '" << dst << "' not found!\n";
+            return false;
+        }
+        return true;
+    }
+    
+    // Checks ids and counts in a snapshot payload before anything is restored
+    bool validateSnapshot(const SnapshotHeader& header, const char* begin, const char* end) const {
+        SnapshotReader in(begin, end);
+        unsigned long long queued = 0, docked = 0;
+        
+        for (unsigned int p = 0; p < header.portCount; p++) {
+            SnapshotPort port;
+            if (!in.read(&port, sizeof(port))) return false;
+            if (memchr(port.portName, '\0', MAX_NAME_LENGTH) == NULL) return false;
+            if (port.dockingSlots == 0 || port.dockedCount > port.dockingSlots) return false;
+            for (unsigned int i = 0; i < port.dockedCount; i++) {
+                unsigned int release;
+                if (!in.read(&release, sizeof(release))) return false;
+            }
+            queued += port.queueLength;
+            docked += port.dockedCount;
+        }
+        if (queued != header.queuedShipCount || docked != header.dockedShipCount) return false;
+        
+        for (unsigned int c = 0; c < header.companyCount; c++) {
+            char name[MAX_COMPANY_LENGTH];
+            if (!in.read(name, MAX_COMPANY_LENGTH)) return false;
+            if (memchr(name, '\0', MAX_COMPANY_LENGTH) == NULL) return false;
+        }
+        
+        unsigned int previous = 0;
+        for (unsigned int p = 0; p <= header.portCount; p++) {
+            unsigned int offset;
+            if (!in.read(&offset, sizeof(offset))) return false;
+            if (offset < previous || (p == 0 && offset != 0)) return false;
+            previous = offset;
+        }
+        if (previous != header.edgeCount) return false;
+        
+        for (unsigned int e = 0; e < header.edgeCount; e++) {
+            SnapshotEdge edge;
+            if (!in.read(&edge, sizeof(edge))) return false;
+            if (edge.destination >= header.portCount || edge.companyId >= header.companyCount) {
+                return false;
+            }
+        }
+        
+        if (header.landmarkCount > header.portCount) return false;
+        for (unsigned int i = 0; i < header.landmarkCount; i++) {
+            unsigned int landmark;
+            if (!in.read(&landmark, sizeof(landmark)) || landmark >= header.portCount) return false;
+        }
+        for (unsigned long long i = 0; i < 2ULL * header.portCount * header.landmarkCount; i++) {
+            unsigned int distance;
+            if (!in.read(&distance, sizeof(distance))) return false;
+        }
+        
+        for (unsigned int s = 0; s < header.queuedShipCount; s++) {
+            SnapshotShip ship;
+            if (!in.read(&ship, sizeof(ship))) return false;
+            if (memchr(ship.shipName, '\0', MAX_NAME_LENGTH) == NULL ||
+                memchr(ship.arrivalDate, '\0', MAX_DATE_LENGTH) == NULL) return false;
+            if (ship.originPort >= header.portCount || ship.companyId >= header.companyCount) {
+                return false;
+            }
+        }
+        return in.atEnd();
+    }
+    
+    // Restores the network from a snapshot taken of the given source files.
+    // Returns false, leaving the graph empty, if the snapshot is missing,
+    // stale, corrupt or from another build.
+    bool loadSnapshot(const char* path, const FileStamp& charges, const FileStamp& routes) {
+        MappedFile file;
+        if (!file.open(path)) return false;
+        
+        SnapshotHeader header;
+        if (file.size() < sizeof(header)) {
+            *log << "Snapshot " << path << " is truncated - reloading text files\n";
+            return false;
+        }
+        memcpy(&header, file.begin(), sizeof(header));
+        
+        if (memcmp(header.magic, "OCEANSNP", 8) != 0 || header.version != SNAPSHOT_VERSION ||
+            header.endianMark != SNAPSHOT_ENDIAN_MARK) {
+            *log << "Snapshot " << path << " has an unsupported format - reloading text files\n";
+            return false;
+        }
+        if (!sameStamp(header.charges, charges) || !sameStamp(header.routes, routes)) {
+            *log << "Snapshot " << path << " is out of date - reloading text files\n";
+            return false;
+        }
+        
+        const char* payload = file.begin() + sizeof(header);
+        if (header.payloadSize != (unsigned long long)(file.size() - sizeof(header)) ||
+            checksumBytes(payload, (size_t)header.payloadSize) != header.checksum ||
+            !validateSnapshot(header, payload, file.end())) {
+            *log << "Snapshot " << path << " is corrupt - reloading text files\n";
+            return false;
+        }
+        
+        if (!ensurePortCapacity(header.portCount)) {
+            *log << "Error: Not enough memory to load snapshot\n";
+            return false;
+        }
+        
+        SnapshotReader in(payload, file.end());
+        unsigned int* queueLengths = new (nothrow) unsigned int[header.portCount + 1];
+        if (!queueLengths) {
+            *log << "Error: Not enough memory to load snapshot\n";
+            return false;
+        }
+        
+        for (unsigned int p = 0; p < header.portCount; p++) {
+            SnapshotPort saved;
+            in.read(&saved, sizeof(saved));
+            
+            strcpy(ports[p].portName, saved.portName);
+            ports[p].dailyDockingCharge = saved.dailyDockingCharge;
+            ports[p].routeListHead = NULL;
+            ports[p].routeListTail = NULL;
+            initPortQueue(ports[p], saved.dockingSlots);
+            for (unsigned int i = 0; i < saved.dockedCount; i++) {
+                unsigned int release = 0;
+                in.read(&release, sizeof(release));
+                ports[p].dockedShips->push(release);
+                ports[p].berthsFree->push(release);
+            }
+            queueLengths[p] = saved.queueLength;
+            portLookup.insert(ports[p].portName, p, ports);
+            totalPorts++;
+        }
+        
+        for (unsigned int c = 0; c < header.companyCount; c++) {
+            char name[MAX_COMPANY_LENGTH];
+            in.read(name, MAX_COMPANY_LENGTH);
+            companies.intern(name, (int)strlen(name));
+        }
+        
+        // Adjacency goes straight into the CSR columns; route lists are
+        // relinked from the same edges
+        bool indexed = (csr.offsets = new (nothrow) unsigned int[header.portCount + 1]) != NULL;
+        if (indexed) {
+            in.read(csr.offsets, (header.portCount + 1) * sizeof(unsigned int));
+            indexed = csr.allocateEdges(header.edgeCount);
+        } else {
+            unsigned int skipped;
+            for (unsigned int p = 0; p <= header.portCount; p++) in.read(&skipped, sizeof(skipped));
+        }
+        
+        unsigned int from = 0, loaded = 0;
+        for (unsigned int e = 0; e < header.edgeCount; e++) {
+            SnapshotEdge edge;
+            in.read(&edge, sizeof(edge));
+            if (!indexed) continue;
+            while (csr.offsets[from + 1] <= e) from++;
+            
+            RouteNode* node = new (nothrow) RouteNode();
+            if (!node) {
+                csr.clear();
+                indexed = false;
+                continue;
+            }
+            node->destinationIndex = edge.destination;
+            node->voyageCost = edge.voyageCost;
+            node->voyageDay = edge.voyageDay;
+            node->departureMins = edge.departureMins;
+            node->arrivalMins = edge.arrivalMins;
+            node->companyId = edge.companyId;
+            node->nextRoute = NULL;
+            
+            if (!ports[from].routeListHead) {
+                ports[from].routeListHead = node;
+            } else {
+                ports[from].routeListTail->nextRoute = node;
+            }
+            ports[from].routeListTail = node;
+            loaded++;
+            
+            csr.destination[e] = edge.destination;
+            csr.departureMins[e] = edge.departureMins;
+            csr.arrivalMins[e] = edge.arrivalMins;
+            csr.voyageCost[e] = edge.voyageCost;
+            csr.voyageDay[e] = edge.voyageDay;
+            csr.companyId[e] = edge.companyId;
+            csr.route[e] = node;
+        }
+        if (indexed) {
+            csr.portCount = header.portCount;
+        } else {
+            *log << "Error: Not enough memory to index routes\n";
+        }
+        
+        bool bounded = indexed && csr.buildDepartureOrder() && csr.buildReverse() &&
+                       landmarks.restore(in, header.landmarkCount, header.portCount);
+        if (!bounded) {
+            unsigned int skipped;
+            unsigned long long words = header.landmarkCount + 
+                                       2ULL * header.portCount * header.landmarkCount;
+            for (unsigned long long i = 0; i < words; i++) in.read(&skipped, sizeof(skipped));
+            if (indexed) *log << "Warning: Not enough memory for route search indexes\n";
+        }
+        
+        for (unsigned int p = 0; p < header.portCount; p++) {
+            for (unsigned int s = 0; s < queueLengths[p]; s++) {
+                SnapshotShip saved;
+                in.read(&saved, sizeof(saved));
+                
+                Ship ship;
+                strcpy(ship.shipName, saved.shipName);
+                minutesToTime(saved.arrivalMins, ship.arrivalTime);
+                strcpy(ship.arrivalDate, saved.arrivalDate);
+                ship.arrivalDay = saved.arrivalDay;
+                ship.arrivalMins = saved.arrivalMins;
+                ship.serviceTimeNeeded = saved.serviceTimeNeeded;
+                strcpy(ship.originPort, ports[saved.originPort].portName);
+                strcpy(ship.destinationPort, ports[p].portName);
+                strcpy(ship.company, companies.name(saved.companyId));
+                ship.voyageCost = saved.voyageCost;
+                queueShip(ports[p], ship);
+            }
+        }
+        delete[] queueLengths;
+        
+        arrivalsSimulated = header.arrivalsSimulated;
+        scheduledShips = header.shipCount;
+        publishQueueWaits();
+        markNetworkChanged();
+        
+        *log << "Loaded snapshot " << path << ": " << totalPorts << " ports, " << loaded 
+             << " routes, " << arrivalsSimulated << " of " << scheduledShips 
+             << " ship arrivals simulated.\n\n";
+        return true;
+    }
+    
+    // Writes the loaded network to path, via a temporary file so a crash
+    // never leaves a half-written snapshot behind
+    bool saveSnapshot(const char* path, const FileStamp& charges, const FileStamp& routes) {
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) return false;
+        
+        unsigned int queued = 0, docked = 0;
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            queued += (unsigned int)ports[p].waitingQueue->getSize();
+            docked += ports[p].dockedShips->size();
+        }
+        
+        SnapshotHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "OCEANSNP", 8);
+        header.version = SNAPSHOT_VERSION;
+        header.endianMark = SNAPSHOT_ENDIAN_MARK;
+        header.dockedShipCount = docked;
+        header.portCount = totalPorts;
+        header.companyCount = companies.size();
+        header.edgeCount = csr.edgeCount;
+        header.queuedShipCount = queued;
+        header.shipCount = scheduledShips;
+        header.arrivalsSimulated = arrivalsSimulated;
+        header.landmarkCount = landmarks.size();
+        header.charges = charges;
+        header.routes = routes;
+        header.payloadSize = (unsigned long long)totalPorts * sizeof(SnapshotPort) +
+                             (unsigned long long)docked * sizeof(unsigned int) +
+                             (unsigned long long)companies.size() * MAX_COMPANY_LENGTH +
+                             (unsigned long long)(totalPorts + 1) * sizeof(unsigned int) +
+                             (unsigned long long)csr.edgeCount * sizeof(SnapshotEdge) +
+                             (unsigned long long)landmarks.size() * sizeof(unsigned int) +
+                             2ULL * totalPorts * landmarks.size() * sizeof(unsigned int) +
+                             (unsigned long long)queued * sizeof(SnapshotShip);
+        
+        char* payload = new (nothrow) char[(size_t)header.payloadSize];
+        if (!payload) return false;
+        SnapshotWriter out(payload);
+        
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            SnapshotPort saved;
+            memset(&saved, 0, sizeof(saved));   // padding is part of the checksum
+            strcpy(saved.portName, ports[p].portName);
+            saved.dailyDockingCharge = ports[p].dailyDockingCharge;
+            saved.dockingSlots = ports[p].dockingSlots;
+            saved.dockedCount = ports[p].dockedShips->size();
+            saved.queueLength = (unsigned int)ports[p].waitingQueue->getSize();
+            out.write(&saved, sizeof(saved));
+            for (unsigned short i = 0; i < saved.dockedCount; i++) {
+                unsigned int release = ports[p].dockedShips->at(i);
+                out.write(&release, sizeof(release));
+            }
+        }
+        
+        for (unsigned int c = 0; c < companies.size(); c++) {
+            char name[MAX_COMPANY_LENGTH];
+            memset(name, 0, MAX_COMPANY_LENGTH);
+            strcpy(name, companies.name(c));
+            out.write(name, MAX_COMPANY_LENGTH);
+        }
+        
+        out.write(csr.offsets, (totalPorts + 1) * sizeof(unsigned int));
+        for (unsigned int e = 0; e < csr.edgeCount; e++) {
+            SnapshotEdge edge;
+            memset(&edge, 0, sizeof(edge));
+            edge.destination = csr.destination[e];
+            edge.voyageCost = csr.voyageCost[e];
+            edge.voyageDay = csr.voyageDay[e];
+            edge.departureMins = csr.departureMins[e];
+            edge.arrivalMins = csr.arrivalMins[e];
+            edge.companyId = csr.companyId[e];
+            out.write(&edge, sizeof(edge));
+        }
+        
+        if (landmarks.size() > 0) {
+            size_t tableBytes = (size_t)totalPorts * landmarks.size() * sizeof(unsigned int);
+            out.write(landmarks.landmarkPorts(), landmarks.size() * sizeof(unsigned int));
+            out.write(landmarks.distancesFrom(), tableBytes);
+            out.write(landmarks.distancesTo(), tableBytes);
+        }
+        
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            for (const QueueNode* node = ports[p].waitingQueue->first(); node; node = node->next) {
+                const Ship& ship = node->ship;
+                int origin = getPortIndex(ship.originPort);
+                int company = companies.find(ship.company);
+                
+                SnapshotShip saved;
+                memset(&saved, 0, sizeof(saved));
+                strcpy(saved.shipName, ship.shipName);
+                strcpy(saved.arrivalDate, ship.arrivalDate);
+                saved.arrivalDay = ship.arrivalDay;
+                saved.arrivalMins = ship.arrivalMins;
+                saved.companyId = (unsigned short)(company == -1 ? 0 : company);
+                saved.originPort = (unsigned int)(origin == -1 ? p : origin);
+                saved.serviceTimeNeeded = ship.serviceTimeNeeded;
+                saved.voyageCost = ship.voyageCost;
+                out.write(&saved, sizeof(saved));
+            }
+        }
+        
+        header.checksum = checksumBytes(payload, (size_t)header.payloadSize);
+        
+        char tempPath[256];
+        snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+        ofstream snapshot(tempPath, ios::binary | ios::trunc);
+        bool written = snapshot.is_open() &&
+                       snapshot.write((const char*)&header, sizeof(header)) &&
+                       snapshot.write(payload, (streamsize)header.payloadSize);
+        snapshot.close();
+        delete[] payload;
+        
+        if (!written) {
+            remove(tempPath);
+            return false;
+        }
+        remove(path);   // rename does not replace existing files on Windows
+        return rename(tempPath, path) == 0;
+    }
+
+public:
+    Graph() : ports(NULL), totalPorts(0), portCapacity(0), arrivalsSimulated(0), 
+              scheduledShips(0), networkGeneration(0), log(&cout) {}
+
+    // Load messages go to out instead of the console, e.g. for a
+    // background reload that reports once it is done
+    void setLog(ostream& out) {
+        log = &out;
+    }
+
+    int getPortIndex(const char* portName) const {
+        return portLookup.find(portName, ports);
+    }
+
+    unsigned int getArrivalsSimulated() const {
+        return arrivalsSimulated;
+    }
+
+    inline bool isValidPortIndex(int index) const {
+        return (index >= 0 && (unsigned int)index < totalPorts);
+    }
+
+    void loadPortCharges() {
+        const char* fileName = "PortCharges.txt";
+        MappedFile file;
+        if (!file.open(fileName)) {
+            *log << "Error: Could not open PortCharges.txt\n";
+            return;
+        }
+        markNetworkChanged();
+
+        LineTokenizer lines(file.begin(), file.end());
+        Token fields[4];    // name charge [berths], plus one slot to catch extra fields
+        int count, malformed = 0;
+        
+        while ((count = lines.readLine(fields, 4)) != -1) {
+            if (count == 0) continue;
+            int line = lines.getLineNumber();
+            
+            if (count < 2) {
+                reportMalformed(fileName, line, fields[0], "missing docking charge after", malformed, *log);
+                continue;
+            }
+            if (count > 3) {
+                reportMalformed(fileName, line, fields[3], "unexpected extra field", malformed, *log);
+                continue;
+            }
+            
+            int charge, berths = DEFAULT_DOCKING_SLOTS;
+            if (fields[0].length >= MAX_NAME_LENGTH) {
+                reportMalformed(fileName, line, fields[0], "port name too long", malformed, *log);
+                continue;
+            }
+            if (!parseIntField(fields[1], charge)) {
+                reportMalformed(fileName, line, fields[1], "invalid docking charge", malformed, *log);
+                continue;
+            }
+            if (count == 3 && (!parseIntField(fields[2], berths) || berths < 1 || berths > USHRT_MAX)) {
+                reportMalformed(fileName, line, fields[2], "invalid berth count", malformed, *log);
+                continue;
+            }
+            if (charge < 0) continue;
+            if (!ensurePortCapacity(totalPorts + 1)) break;
+            
+            copyToken(fields[0], ports[totalPorts].portName, MAX_NAME_LENGTH);
+            ports[totalPorts].dailyDockingCharge = (unsigned short)charge;
+            ports[totalPorts].routeListHead = NULL;
+            ports[totalPorts].routeListTail = NULL;
+            initPortQueue(ports[totalPorts], (unsigned short)berths);
+            portLookup.insert(ports[totalPorts].portName, totalPorts, ports);
+            totalPorts++;
+        }
+
+        reportMalformedSummary(fileName, malformed, *log);
+        *log << "Loaded " << totalPorts << " ports.\n";
+    }
+
+    // chunkCount forces the number of parallel chunks; 0 picks it from the
+    // file size and core count
+    void loadRoutes(int chunkCount = 0) {
+        const char* fileName = "Routes.txt";
+        MappedFile file;
+        if (!file.open(fileName)) {
+            *log << "Error: Could not open Routes.txt\n";
+            return;
+        }
+
+        // Parse newline-aligned chunks in parallel, each into its own buffers
+        if (chunkCount <= 0) chunkCount = chooseLoaderThreads(file.size());
+        RouteChunk* chunks = new (nothrow) RouteChunk[chunkCount];
+        if (!chunks) {
+            *log << "Error: Not enough memory to load routes\n";
+            return;
+        }
+        chunkCount = splitIntoChunks(file.begin(), file.end(), chunks, chunkCount);
+        
+        thread* workers = (chunkCount > 1) ? new (nothrow) thread[chunkCount - 1] : NULL;
+        int spawned = 0;
+        for (int c = 1; workers && c < chunkCount; c++) {
+            workers[c - 1] = thread(parseRouteChunk, &chunks[c], &portLookup, ports);
+            spawned++;
+        }
+        parseRouteChunk(&chunks[0], &portLookup, ports);
+        for (int c = 1; c <= spawned; c++) {
+            workers[c - 1].join();
+        }
+        delete[] workers;
+        for (int c = spawned + 1; c < chunkCount; c++) {
+            parseRouteChunk(&chunks[c], &portLookup, ports);  // no thread memory
+        }
+        
+        // Merge in file order so ids, list order and messages match a
+        // single-threaded load exactly
+        int loaded = 0, malformed = 0, lineOffset = 0, parsedTotal = 0;
+        for (int c = 0; c < chunkCount; c++) {
+            parsedTotal += chunks[c].routeCount;
+        }
+        
+        // Every scheduled sailing becomes a ship in the arrival simulation
+        ShipBuffer allShips;
+        allShips.reserve(parsedTotal);
+        bool stopped = false;
+        
+        for (int c = 0; c < chunkCount && !stopped; c++) {
+            RouteChunk& chunk = chunks[c];
+            if (chunk.outOfMemory) {
+                *log << "Error: Not enough memory to parse " << fileName << "\n";
+            }
+            
+            for (int i = 0; i < chunk.errorCount; i++) {
+                reportMalformed(fileName, lineOffset + chunk.errors[i].line, 
+                                chunk.errors[i].token, chunk.errors[i].message, malformed, *log);
+            }
+            
+            for (int i = 0; i < chunk.routeCount; i++) {
+                const ParsedRoute& parsed = chunk.routes[i];
+                
+                int line = lineOffset + parsed.line;
+                int companyId = companies.intern(parsed.company.text, parsed.company.length);
+                if (companyId == -1 && companies.size() > USHRT_MAX) {
+                    reportMalformed(fileName, line, parsed.company, "company table full for", 
+                                    malformed, *log);
+                    continue;
+                }
+                
+                RouteNode* node = (companyId == -1) ? NULL : new (nothrow) RouteNode();
+                if (!node) {
+                    *log << "Error: Not enough memory to load routes - stopped at " << fileName 
+                         << ":" << line << "\n";
+                    stopped = true;
+                    break;
+                }
+                
+                node->destinationIndex = (unsigned int)parsed.toIdx;
+                node->voyageCost = (unsigned int)parsed.cost;
+                node->voyageDay = parsed.voyageDay;
+                node->departureMins = parsed.departureMins;
+                node->arrivalMins = parsed.arrivalMins;
+                node->companyId = (unsigned short)companyId;
+                node->nextRoute = NULL;
+                
+                Port& from = ports[parsed.fromIdx];
+                if (!from.routeListHead) {
+                    from.routeListHead = node;
+                    from.routeListTail = node;
+                } else {
+                    from.routeListTail->nextRoute = node;
+                    from.routeListTail = node;
+                }
+                
+                // Create ship for queue simulation (store in buffer first)
+                Ship* newShip = allShips.append();
+                if (newShip) {
+                    Ship& ship = *newShip;
+                    char company[MAX_COMPANY_LENGTH], date[MAX_DATE_LENGTH];
+                    copyToken(parsed.company, company, MAX_COMPANY_LENGTH);
+                    copyToken(parsed.date, date, MAX_DATE_LENGTH);
+                    
+                    snprintf(ship.shipName, MAX_NAME_LENGTH, "%s_%s_%d", company, date, allShips.size() - 1);
+                    minutesToTime(parsed.arrivalMins, ship.arrivalTime);
+                    strcpy(ship.arrivalDate, date);
+                    ship.arrivalDay = parsed.voyageDay;
+                    ship.arrivalMins = parsed.arrivalMins;
+                    ship.serviceTimeNeeded = calculateServiceTime(parsed.cost);
+                    strcpy(ship.originPort, from.portName);
+                    strcpy(ship.destinationPort, ports[parsed.toIdx].portName);
+                    strcpy(ship.company, company);
+                    ship.voyageCost = parsed.cost;
+                }
+                
+                loaded++;
+            }
+            lineOffset += chunk.lineCount;
+        }
+        delete[] chunks;
+
+        reportMalformedSummary(fileName, malformed, *log);
+        
         // CRITICAL FIX: Sort all ships by arrival date and time
-        cout << "Sorting " << shipCount << " ships by arrival time...\n";
-        sortShipsByArrival(allShips, shipCount);
+        int shipCount = allShips.size();
+        scheduledShips = (unsigned int)shipCount;
+        *log << "Sorting " << shipCount << " ships by arrival time...\n";
+        int* arrivalOrder = new (nothrow) int[shipCount];
+        if (!arrivalOrder || !sortShipsByArrival(allShips.data(), shipCount, arrivalOrder)) {
+            *log << "Error: Not enough memory to sort ships\n";
+            delete[] arrivalOrder;
+            arrivalOrder = NULL;
+        }
+        
+        // Now simulate ship arrivals in chronological order
+        *log << "Simulating port arrivals in chronological order...\n";
+        for (int i = 0; arrivalOrder && i < shipCount; i++) {
+            const Ship& ship = allShips.data()[arrivalOrder[i]];
+            int destIdx = getPortIndex(ship.destinationPort);
+            if (destIdx != -1) {
+                simulateShipArrival(destIdx, ship);
+            }
+        }
+        
+        // Clean up
+        delete[] arrivalOrder;
+        
+        // Freeze the adjacency lists and queue waits into what the searches read
+        publishQueueWaits();
+        if (!csr.build(ports, totalPorts)) {
+            *log << "Error: Not enough memory to index routes\n";
+        } else {
+            buildSearchIndexes();
+        }
+        
+        markNetworkChanged();
+        *log << "Loaded " << loaded << " routes.\n";
+        *log << "Port queues initialized with " << arrivalsSimulated << " of " << shipCount
+             << " ship arrivals simulated (chronologically sorted).\n\n";
+    }
+
+    // Incremental schedule changes. Each one patches the port's route list,
+    // the CSR and its timetable and reverse views in place, repairs the
+    // landmark bounds and invalidates cached answers, instead of going
+    // through loadRoutes again. Route keys are source, destination, date,
+    // departure time and company.
+    
+    // A new route reuses a cancelled slot of src when there is one, so it
+    // costs a scan of src's routes plus two array shifts. Only when src has
+    // none left are the CSR and its views rebuilt from the route lists; the
+    // rebuild drops surplus cancelled slots and leaves free ones at every
+    // port, with src's share growing with its route count.
+    int addRoute(unsigned int src, unsigned int dest, unsigned short day, unsigned short depMins,
+                 unsigned short arrMins, unsigned int cost, const char* company) {
+        if (!isValidPortIndex((int)src) || !isValidPortIndex((int)dest)) return UPDATE_INVALID_PORT;
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) return UPDATE_NO_MEMORY;
+        
+        int length = (int)strlen(company);
+        int companyId = companies.intern(company, length);
+        if (companyId == -1) {
+            bool rejected = length >= MAX_COMPANY_LENGTH || companies.size() > USHRT_MAX;
+            return rejected ? UPDATE_INVALID_COMPANY : UPDATE_NO_MEMORY;
+        }
+        RouteNode* node = new (nothrow) RouteNode();
+        if (!node) return UPDATE_NO_MEMORY;
+        node->destinationIndex = dest;
+        node->voyageCost = cost;
+        node->voyageDay = day;
+        node->departureMins = depMins;
+        node->arrivalMins = arrMins;
+        node->companyId = (unsigned short)companyId;
+        node->nextRoute = NULL;
+        
+        int slot = -1;
+        for (unsigned int e = csr.offsets[src]; e < csr.offsets[src + 1]; e++) {
+            if (csr.isCancelled(e)) {
+                slot = (int)e;
+                break;
+            }
+        }
+        
+        unsigned int e;
+        if (slot != -1) {
+            // Link the node where the slot sits among src's live routes
+            e = (unsigned int)slot;
+            RouteNode* before = NULL;
+            for (unsigned int k = e; k > csr.offsets[src] && !before; k--) {
+                before = csr.route[k - 1];
+            }
+            if (before) {
+                node->nextRoute = before->nextRoute;
+                before->nextRoute = node;
+            } else {
+                node->nextRoute = ports[src].routeListHead;
+                ports[src].routeListHead = node;
+            }
+            if (!node->nextRoute) ports[src].routeListTail = node;
+            
+            unsigned int oldKey = departureMinute(csr.voyageDay[e], csr.departureMins[e]);
+            unsigned int oldDest = csr.destination[e];
+            csr.destination[e] = dest;
+            csr.departureMins[e] = depMins;
+            csr.arrivalMins[e] = arrMins;
+            csr.voyageCost[e] = cost;
+            csr.voyageDay[e] = day;
+            csr.companyId[e] = (unsigned short)companyId;
+            csr.route[e] = node;
+            csr.reorderDeparture(e, oldKey);
+            csr.regroupReverse(e, oldDest);
+        } else {
+            if (ports[src].routeListTail) {
+                ports[src].routeListTail->nextRoute = node;
+            } else {
+                ports[src].routeListHead = node;
+            }
+            ports[src].routeListTail = node;
+            
+            if (!csr.build(ports, totalPorts, (int)src) || !csr.buildDepartureOrder() || 
+                !csr.buildReverse()) {
+                *log << "Error: Not enough memory to index routes\n";
+                routesChanged();
+                return UPDATE_NO_MEMORY;
+            }
+            // The new route is src's last live slot
+            e = csr.offsets[src + 1];
+            while (csr.isCancelled(--e)) {}
+        }
+        
+        repairBounds(e);
+        routesChanged();
+        return UPDATE_APPLIED;
+    }
+    
+    // The slot stays in the CSR, dated CANCELLED_DAY so no search uses it
+    int cancelRoute(unsigned int src, unsigned int dest, unsigned short day, 
+                    unsigned short depMins, const char* company) {
+        if (!isValidPortIndex((int)src) || !isValidPortIndex((int)dest)) return UPDATE_INVALID_PORT;
+        int e = findRouteEdge(src, dest, day, depMins, companies.find(company));
+        if (e == -1) return UPDATE_NOT_FOUND;
+        
+        unlinkRoute(src, csr.route[e]);
+        delete csr.route[e];
+        csr.route[e] = NULL;
+        
+        unsigned int oldKey = departureMinute(csr.voyageDay[e], csr.departureMins[e]);
+        csr.voyageDay[e] = CANCELLED_DAY;
+        csr.reorderDeparture((unsigned int)e, oldKey);
+        routeRaised(src, (unsigned int)e);
+        return UPDATE_APPLIED;
+    }
+    
+    int repriceRoute(unsigned int src, unsigned int dest, unsigned short day, 
+                     unsigned short depMins, const char* company, unsigned int cost) {
+        if (!isValidPortIndex((int)src) || !isValidPortIndex((int)dest)) return UPDATE_INVALID_PORT;
+        int e = findRouteEdge(src, dest, day, depMins, companies.find(company));
+        if (e == -1) return UPDATE_NOT_FOUND;
+        
+        bool cheaper = cost < csr.voyageCost[e];
+        csr.voyageCost[e] = cost;
+        csr.route[e]->voyageCost = cost;
+        if (cheaper) {
+            repairBounds((unsigned int)e);
+            routesChanged();
+        } else {
+            routeRaised(src, (unsigned int)e);
+        }
+        return UPDATE_APPLIED;
+    }
+
+    // Optional preprocessing for fast unfiltered cheapest-route queries
+    void buildContractionHierarchy() {
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory to index routes!\n";
+            return;
+        }
+        
+        cout << "\nContracting " << totalPorts << " ports over " << csr.liveEdgeCount() << " routes...\n";
+        bool built = queueWaits.costPenalty && 
+                     hierarchy.build(csr, queueWaits.costPenalty, CANCELLED_DAY + 1);
+        markNetworkChanged();     // cached answers name the search that found them
+        
+        if (!built) {
+            cout << "❌ Could not build a contraction hierarchy (network too dense or out of memory).\n";
+            cout << "   Cheapest-route queries keep using A*/Dijkstra.\n";
+            return;
+        }
+        cout << "✓ Contraction hierarchy ready: " << hierarchy.getArcCount() << " arcs ("
+             << hierarchy.getShortcutCount() << " shortcuts).\n";
+        cout << "  Unfiltered queries now use it; one dated past the first sailing\n";
+        cout << "  rebuilds it over the routes sailing from that date.\n";
+    }
+
+    // Cheapest cost and hours from every port to every other over routes
+    // sailing on or after date, one single-source search per row spread over
+    // a pool of threads. Prints nothing; false if the date is invalid or
+    // memory ran out.
+    bool computeCostMatrix(const char* date, CostMatrix& matrix, int& threadsUsed) const {
+        threadsUsed = 0;
+        if (!isValidDate(date) || !matrix.isValid() || matrix.portCount != totalPorts || 
+            !csr.isBuilt()) return false;
+        
+        unsigned short fromDay = dateToDayNumber(date);
+        atomic<unsigned int> nextRow(0);
+        atomic<bool> outOfMemory(false);
+        
+        int threadCount = chooseMatrixThreads(totalPorts);
+        thread* workers = (threadCount > 1) ? new (nothrow) thread[threadCount - 1] : NULL;
+        int spawned = 0;
+        for (int t = 1; workers && t < threadCount; t++) {
+            workers[t - 1] = thread(&Graph::fillMatrixRows, this, &matrix, fromDay, &nextRow, &outOfMemory);
+            spawned++;
+        }
+        fillMatrixRows(&matrix, fromDay, &nextRow, &outOfMemory);
+        for (int t = 1; t <= spawned; t++) {
+            workers[t - 1].join();
+        }
+        delete[] workers;
+        
+        threadsUsed = spawned + 1;
+        return !outOfMemory;
+    }
+    
+    // Writes one matrix as CSV: a header of port names, then one row per source
+    bool writeMatrixCSV(const char* fileName, const unsigned int* values) const {
+        ofstream out(fileName);
+        if (!out) return false;
+        
+        out << "From/To";
+        for (unsigned int to = 0; to < totalPorts; to++) {
+            out << "," << ports[to].portName;
+        }
+        out << "\n";
+        for (unsigned int from = 0; from < totalPorts; from++) {
+            const unsigned int* row = values + (unsigned long long)from * totalPorts;
+            out << ports[from].portName;
+            for (unsigned int to = 0; to < totalPorts; to++) {
+                out << ",";
+                if (row[to] != UINT_MAX) out << row[to];
+            }
+            out << "\n";
+        }
+        return (bool)out;
+    }
+    
+    // All-pairs cost/time report for network planning
+    void exportCostMatrix() {
+        char date[MAX_DATE_LENGTH];
+        cout << "\n--- Export Cost/Time Matrix (All Pairs) ---\n";
+        cout << "Date (DD/MM/YYYY): ";
+        cin >> date;
+        
+        if (!isValidDate(date)) {
+            cout << "\n❌ Invalid date format!\n";
+            return;
+        }
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        CostMatrix matrix(totalPorts);
+        int threadsUsed;
+        if (!computeCostMatrix(date, matrix, threadsUsed)) {
+            cout << "\n❌ Not enough memory for a " << totalPorts << " x " << totalPorts << " matrix!\n";
+            return;
+        }
+        
+        unsigned long long reachable = 0;
+        for (unsigned long long i = 0; i < (unsigned long long)totalPorts * totalPorts; i++) {
+            if (matrix.cost[i] != UINT_MAX) reachable++;
+        }
+        
+        if (!writeMatrixCSV(COST_MATRIX_FILE, matrix.cost) || 
+            !writeMatrixCSV(TIME_MATRIX_FILE, matrix.hours)) {
+            cout << "\n❌ Could not write the matrix files!\n";
+            return;
+        }
+        cout << "\n✓ " << totalPorts << " x " << totalPorts << " matrix computed on " 
+             << threadsUsed << " thread(s); " << reachable << " reachable pairs.\n";
+        cout << "  Costs (USD): " << COST_MATRIX_FILE << "\n";
+        cout << "  Times (hours): " << TIME_MATRIX_FILE << "\n";
+        cout << "  Empty cells are unreachable.\n";
+    }
+
+    // Answers many cheapest-route requests at once. Requests sharing source,
+    // date and preferences form a group answered from one Dijkstra tree, and
+    // groups run in parallel. results[i] answers queries[i] with totals only
+    // (path and legs stay NULL). Prints nothing; false if memory ran out.
+    bool answerBatch(const RouteQuery* queries, unsigned int count, RouteResult* results,
+                     unsigned int& groupCount, int& threadsUsed) const {
+        groupCount = 0;
+        threadsUsed = 0;
+        if (!csr.isBuilt()) return false;
+        
+        // Requests that fail validation never join a group
+        int* valid = new (nothrow) int[count + 1];
+        unsigned int* keys = new (nothrow) unsigned int[count + 1];
+        int* byDatePrefs = new (nothrow) int[count + 1];
+        int* bySource = new (nothrow) int[count + 1];
+        int* order = new (nothrow) int[count + 1];
+        unsigned int* groupStart = new (nothrow) unsigned int[count + 1];
+        bool ok = valid && keys && byDatePrefs && bySource && order && groupStart;
+        
+        int validCount = 0;
+        for (unsigned int i = 0; ok && i < count; i++) {
+            const RouteQuery& q = queries[i];
+            results[i] = RouteResult();
+            if (!isValidPortIndex(q.srcIdx) || !isValidPortIndex(q.destIdx)) {
+                results[i].status = QUERY_INVALID_PORT;
+            } else if (!isValidDate(q.date)) {
+                results[i].status = QUERY_INVALID_DATE;
+            } else if (q.srcIdx == q.destIdx) {
+                results[i].status = QUERY_SAME_PORT;
+            } else {
+                valid[validCount++] = (int)i;
+            }
+        }
+        
+        // Two stable passes: by (date, preferences hash), then by source
+        for (int i = 0; ok && i < validCount; i++) {
+            const RouteQuery& q = queries[valid[i]];
+            keys[i] = ((unsigned int)dateToDayNumber(q.date) << 16) | (preferencesHash(q.prefs) & 0xFFFF);
+        }
+        ok = ok && sortIndicesByKey(keys, validCount, byDatePrefs);
+        for (int i = 0; ok && i < validCount; i++) {
+            keys[i] = (unsigned int)queries[valid[byDatePrefs[i]]].srcIdx;
+        }
+        ok = ok && sortIndicesByKey(keys, validCount, bySource);
+        
+        for (int i = 0; ok && i < validCount; i++) {
+            order[i] = valid[byDatePrefs[bySource[i]]];
+            const RouteQuery& q = queries[order[i]];
+            const RouteQuery* head = (groupCount > 0) ? &queries[order[groupStart[groupCount - 1]]] : NULL;
+            if (!head || head->srcIdx != q.srcIdx || dateToDayNumber(head->date) != dateToDayNumber(q.date) ||
+                !samePreferences(head->prefs, q.prefs)) {
+                groupStart[groupCount++] = (unsigned int)i;
+            }
+        }
+        if (ok) groupStart[groupCount] = (unsigned int)validCount;
+        
+        atomic<unsigned int> nextGroup(0);
+        atomic<bool> outOfMemory(false);
+        if (ok && groupCount > 0) {
+            int threadCount = chooseMatrixThreads(groupCount);
+            thread* workers = (threadCount > 1) ? new (nothrow) thread[threadCount - 1] : NULL;
+            int spawned = 0;
+            for (int t = 1; workers && t < threadCount; t++) {
+                workers[t - 1] = thread(&Graph::answerBatchGroups, this, queries, order, groupStart,
+                                        groupCount, results, &nextGroup, &outOfMemory);
+                spawned++;
+            }
+            answerBatchGroups(queries, order, groupStart, groupCount, results, &nextGroup, &outOfMemory);
+            for (int t = 1; t <= spawned; t++) {
+                workers[t - 1].join();
+            }
+            delete[] workers;
+            threadsUsed = spawned + 1;
+        }
+        
+        delete[] valid;
+        delete[] keys;
+        delete[] byDatePrefs;
+        delete[] bySource;
+        delete[] order;
+        delete[] groupStart;
+        return ok && !outOfMemory;
+    }
+    
+    // Quotes every "Source Destination DD/MM/YYYY" line of QUOTE_REQUEST_FILE
+    // through answerBatch and writes one result line each to QUOTE_RESULT_FILE
+    void quoteBatchFromFile() {
+        const char* fileName = QUOTE_REQUEST_FILE;
+        
+        char choice;
+        UserPreferences prefs;
+        cout << "\n--- Batch Quotes (" << fileName << ") ---\n";
+        cout << "Apply preferences to every quote? (y/n): ";
+        cin >> choice;
+        clearInputBuffer();
+        bool usePrefs = (choice == 'y' || choice == 'Y');
+        if (usePrefs) {
+            prefs = getUserPreferences();
+        }
+        
+        MappedFile file;
+        if (!file.open(fileName)) {
+            cout << "\n❌ Could not open " << fileName << "\n";
+            return;
+        }
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        // Upper bound on requests: one per line
+        unsigned int lineCount = 1;
+        for (const char* c = file.begin(); c < file.end(); c++) {
+            if (*c == '\n') lineCount++;
+        }
+        
+        RouteQuery* queries = new (nothrow) RouteQuery[lineCount];
+        RouteResult* results = new (nothrow) RouteResult[lineCount];
+        char (*dates)[MAX_DATE_LENGTH] = new (nothrow) char[lineCount][MAX_DATE_LENGTH];
+        if (!queries || !results || !dates) {
+            delete[] queries;
+            delete[] results;
+            delete[] dates;
+            cout << "\n❌ Not enough memory for " << lineCount << " quotes!\n";
+            return;
+        }
+        
+        LineTokenizer lines(file.begin(), file.end());
+        Token fields[4];    // source destination date, plus one to catch extras
+        int fieldCount, malformed = 0;
+        unsigned int count = 0;
+        
+        while ((fieldCount = lines.readLine(fields, 4)) != -1) {
+            if (fieldCount == 0) continue;
+            int line = lines.getLineNumber();
+            
+            if (fieldCount != 3) {
+                reportMalformed(fileName, line, fields[0], "expected source, destination and date in row", 
+                                malformed);
+                continue;
+            }
+            int src = portLookup.find(fields[0].text, fields[0].length, ports);
+            int dest = portLookup.find(fields[1].text, fields[1].length, ports);
+            if (src == -1) {
+                reportMalformed(fileName, line, fields[0], "unknown source port", malformed);
+                continue;
+            }
+            if (dest == -1) {
+                reportMalformed(fileName, line, fields[1], "unknown destination port", malformed);
+                continue;
+            }
+            if (!copyToken(fields[2], dates[count], MAX_DATE_LENGTH)) {
+                reportMalformed(fileName, line, fields[2], "invalid date", malformed);
+                continue;
+            }
+            
+            queries[count].srcIdx = src;
+            queries[count].destIdx = dest;
+            queries[count].date = dates[count];
+            queries[count].prefs = usePrefs ? &prefs : NULL;
+            count++;
+        }
+        reportMalformedSummary(fileName, malformed);
+        
+        unsigned int groupCount;
+        int threadsUsed;
+        ofstream out(QUOTE_RESULT_FILE);
+        if (!answerBatch(queries, count, results, groupCount, threadsUsed)) {
+            cout << "\n❌ Not enough memory to answer the batch!\n";
+        } else if (!out) {
+            cout << "\n❌ Could not write " << QUOTE_RESULT_FILE << "\n";
+        } else {
+            unsigned int found = 0;
+            for (unsigned int i = 0; i < count; i++) {
+                const RouteResult& r = results[i];
+                out << ports[queries[i].srcIdx].portName << " " << ports[queries[i].destIdx].portName
+                    << " " << queries[i].date << " ";
+                if (r.status == QUERY_FOUND) {
+                    out << r.cost << " " << r.hours << " " << (r.cost + r.dockingCharges) << "\n";
+                    found++;
+                } else if (r.status == QUERY_NO_ROUTE) {
+                    out << "NO_ROUTE\n";
+                } else if (r.status == QUERY_AVOIDS_ENDPOINT) {
+                    out << "AVOIDS_ENDPOINT\n";
+                } else if (r.status == QUERY_SAME_PORT) {
+                    out << "SAME_PORT\n";
+                } else {
+                    out << "INVALID\n";
+                }
+            }
+            cout << "\n✓ " << count << " quotes answered in " << groupCount << " searches on "
+                 << threadsUsed << " thread(s); " << found << " routes found.\n";
+            cout << "  Results (cost, hours, total with port charges): " << QUOTE_RESULT_FILE << "\n";
+        }
+        
+        delete[] queries;
+        delete[] results;
+        delete[] dates;
+    }
+    
+    // Applies a feed of schedule changes, one per line:
+    //   ADD    origin dest date departure arrival cost company
+    //   CANCEL origin dest date departure company
+    //   PRICE  origin dest date departure company cost
+    // Changes live in memory only; a reload from the text files drops them.
+    void applyRouteUpdatesFromFile() {
+        const char* fileName = ROUTE_UPDATE_FILE;
+        
+        cout << "\n--- Route Updates (" << fileName << ") ---\n";
+        MappedFile file;
+        if (!file.open(fileName)) {
+            cout << "❌ Could not open " << fileName << "\n";
+            return;
+        }
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "❌ Not enough memory to index routes!\n";
+            return;
+        }
+        
+        bool hadHierarchy = hierarchy.isBuilt();
+        unsigned int added = 0, cancelled = 0, repriced = 0, missing = 0;
+        LineTokenizer lines(file.begin(), file.end());
+        Token fields[9];    // verb and up to seven fields, plus one to catch extras
+        int count, malformed = 0;
+        
+        while ((count = lines.readLine(fields, 9)) != -1) {
+            if (count == 0) continue;
+            int line = lines.getLineNumber();
+            
+            int expected;
+            const Token& verb = fields[0];
+            if (verb.length == 3 && memcmp(verb.text, "ADD", 3) == 0) {
+                expected = 8;
+            } else if (verb.length == 6 && memcmp(verb.text, "CANCEL", 6) == 0) {
+                expected = 6;
+            } else if (verb.length == 5 && memcmp(verb.text, "PRICE", 5) == 0) {
+                expected = 7;
+            } else {
+                reportMalformed(fileName, line, verb, "expected ADD, CANCEL or PRICE", malformed);
+                continue;
+            }
+            if (count != expected) {
+                reportMalformed(fileName, line, verb, "wrong number of fields for", malformed);
+                continue;
+            }
+            
+            int src = portLookup.find(fields[1].text, fields[1].length, ports);
+            int dest = portLookup.find(fields[2].text, fields[2].length, ports);
+            unsigned short day, depMins, arrMins = 0;
+            int cost = 0;
+            const Token& companyField = fields[expected == 8 ? 7 : 5];
+            char company[MAX_COMPANY_LENGTH];
+            
+            if (src == -1) {
+                reportMalformed(fileName, line, fields[1], "unknown origin port", malformed);
+                continue;
+            }
+            if (dest == -1) {
+                reportMalformed(fileName, line, fields[2], "unknown destination port", malformed);
+                continue;
+            }
+            if (!parseDateField(fields[3], day)) {
+                reportMalformed(fileName, line, fields[3], "invalid date", malformed);
+                continue;
+            }
+            if (!parseTimeField(fields[4], depMins)) {
+                reportMalformed(fileName, line, fields[4], "invalid departure time", malformed);
+                continue;
+            }
+            if (expected == 8 && !parseTimeField(fields[5], arrMins)) {
+                reportMalformed(fileName, line, fields[5], "invalid arrival time", malformed);
+                continue;
+            }
+            if (expected != 6) {
+                if (!parseIntField(fields[6], cost) || cost < 0) {
+                    reportMalformed(fileName, line, fields[6], "invalid cost", malformed);
+                    continue;
+                }
+            }
+            if (!copyToken(companyField, company, MAX_COMPANY_LENGTH)) {
+                reportMalformed(fileName, line, companyField, "company name too long", malformed);
+                continue;
+            }
+            
+            int status;
+            if (expected == 8) {
+                status = addRoute(src, dest, day, depMins, arrMins, (unsigned int)cost, company);
+                if (status == UPDATE_APPLIED) added++;
+            } else if (expected == 6) {
+                status = cancelRoute(src, dest, day, depMins, company);
+                if (status == UPDATE_APPLIED) cancelled++;
+            } else {
+                status = repriceRoute(src, dest, day, depMins, company, (unsigned int)cost);
+                if (status == UPDATE_APPLIED) repriced++;
+            }
+            
+            if (status == UPDATE_NOT_FOUND) {
+                reportMalformed(fileName, line, verb, "no such route for", malformed);
+                missing++;
+            } else if (status == UPDATE_INVALID_COMPANY) {
+                reportMalformed(fileName, line, companyField, "company table full for", malformed);
+            } else if (status == UPDATE_NO_MEMORY) {
+                cout << "❌ Not enough memory - stopped at line " << line << "\n";
+                break;
+            }
+        }
+        reportMalformedSummary(fileName, malformed);
+        
+        cout << "\n✓ " << (added + cancelled + repriced) << " updates applied: " << added 
+             << " added, " << cancelled << " cancelled, " << repriced << " repriced";
+        if (missing > 0) cout << "; " << missing << " not found";
+        cout << ".\n";
+        if (hadHierarchy && !hierarchy.isBuilt()) {
+            cout << "  The contraction hierarchy was dropped - rebuild it with option 7.\n";
+        }
+    }
+
+    void displayRouteCacheStats() const {
+        unsigned long long lookups = routeCache.getHits() + routeCache.getMisses();
+        if (lookups == 0) return;
+        cout << "\nRoute cache: " << routeCache.getHits() << " hits, " << routeCache.getMisses()
+             << " misses (" << (routeCache.getHits() * 100 / lookups) << "% hit rate), "
+             << routeCache.size() << " answers cached\n";
+    }
+
+    void displayGraph() const {
+        if (totalPorts == 0) {
+            cout << "\nNo ports loaded!\n";
+            return;
+        }
+        
+        cout << "\n========== PORT NETWORK ==========\n\n";
+        for (unsigned int i = 0; i < totalPorts; i++) {
+            cout << ports[i].portName << " ($" << ports[i].dailyDockingCharge << "/day)\n";
+            cout << "  Docking: " << ports[i].dockedShips->size() << "/" << ports[i].dockingSlots << " slots occupied\n";
+            ports[i].waitingQueue->display();
+            
+            RouteNode* route = ports[i].routeListHead;
+            if (!route) {
+                cout << "  No outgoing routes\n";
+            } else {
+                cout << "  Outgoing routes:\n";
+                while (route) {
+                    char dateStr[MAX_DATE_LENGTH], depStr[MAX_TIME_LENGTH], arrStr[MAX_TIME_LENGTH];
+                    dayNumberToDate(route->voyageDay, dateStr);
+                    minutesToTime(route->departureMins, depStr);
+                    minutesToTime(route->arrivalMins, arrStr);
+                    
+                    cout << "    → " << ports[route->destinationIndex].portName
+                         << " | " << dateStr
+                         << " | " << depStr << "-" << arrStr
+                         << " | $" << route->voyageCost
+                         << " | " << companies.name(route->companyId) << "\n";
+                    route = route->nextRoute;
+                }
+            }
+            cout << "\n";
+        }
+    }
+
+    // Heap search (Dijkstra, or A* with landmark bounds) filling scratch
+    // with costs, times and predecessors from srcIdx. A destIdx of -1
+    // settles the whole reachable network, or stops once every port in
+    // targets is settled.
+    void runCostSearch(int srcIdx, int destIdx, unsigned short fromDay, bool useAStar,
+                       const UserPreferences* prefs, const RouteFilter& filter,
+                       SearchScratch& scratch, unsigned int& nodesExplored,
+                       unsigned int& routesFiltered, SearchTargets* targets = NULL) const {
+        unsigned int* minCost = scratch.minCost;
+        unsigned int* totalTime = scratch.totalTime;
+        unsigned int* queueWaitTime = scratch.queueWaitTime;
+        bool* visited = scratch.visited;
+        int* prevPort = scratch.prevPort;
+        RouteNode** usedRoute = scratch.usedRoute;
+        
+        PriorityQueue& pq = scratch.queue;
+        
+        if (useAStar) {
+            unsigned int h = calculateHeuristic(srcIdx, destIdx);
+            pq.push(srcIdx, 0, h);
+        } else {
+            pq.push(srcIdx, 0, 0);
+        }
+
+        while (!pq.isEmpty()) {
+            unsigned int currPort;
+            unsigned int currCost, currHeuristic;
+            
+            if (!pq.pop(currPort, currCost, currHeuristic)) break;
+            
+            if (visited[currPort]) continue;
+            visited[currPort] = true;
+            nodesExplored++;
+
+            if (currPort == (unsigned int)destIdx) break;
+            if (targets && targets->mark[currPort] == targets->id && --targets->remaining == 0) break;
+
+            const unsigned int edgeEnd = csr.offsets[currPort + 1];
+            for (unsigned int e = csr.offsets[currPort]; e < edgeEnd; e++) {
+                if (csr.isCancelled(e)) continue;
+                unsigned int nextPort = csr.destination[e];
+                scratch.touch(nextPort);
+                
+                bool passesFilter = true;
+                if (prefs) {
+                    passesFilter = filter.passes(nextPort, csr.voyageCost[e], csr.companyId[e]);
+                    if (!passesFilter) {
+                        routesFiltered++;
+                    }
+                }
+                
+                if (passesFilter && csr.voyageDay[e] >= fromDay) {
+                    bool timeValid = true;
+                    if (prevPort[currPort] != -1 && usedRoute[currPort]) {
+                        timeValid = isValidConnection(
+                            usedRoute[currPort]->arrivalMins,
+                            csr.departureMins[e]
+                        );
+                    }
+                    
+                    if (timeValid && !visited[nextPort]) {
+                        // Calculate queue wait time at next port (Option A - affects cost)
+                        unsigned int queueWait = queueWaits.wait(nextPort);
+                        unsigned int serviceTime = calculateServiceTime(csr.voyageCost[e]);
+                        
+                        // Add queue wait time to cost calculation
+                        unsigned int newCost = minCost[currPort] + csr.voyageCost[e] + 
+                                               queueWaits.penalty(nextPort);
+                        
+                        unsigned int voyageTime = voyageHours(csr.departureMins[e], csr.arrivalMins[e]);
+                        unsigned int newTotalTime = totalTime[currPort] + voyageTime + 
+                                                   (queueWait / 60) + (serviceTime / 60);
+                        
+                        bool withinTimeLimit = true;
+                        if (prefs && prefs->hasMaxTimeLimit) {
+                            withinTimeLimit = (newTotalTime <= prefs->maxTimeLimit);
+                        }
+                        
+                        if (withinTimeLimit && newCost < minCost[nextPort]) {
+                            minCost[nextPort] = newCost;
+                            totalTime[nextPort] = newTotalTime;
+                            queueWaitTime[nextPort] = queueWaitTime[currPort] + (queueWait / 60);
+                            prevPort[nextPort] = currPort;
+                            usedRoute[nextPort] = csr.route[e];
+                            
+                            if (useAStar) {
+                                unsigned int h = calculateHeuristic(nextPort, destIdx);
+                                pq.push(nextPort, newCost, newCost + h);
+                            } else {
+                                pq.push(nextPort, newCost, 0);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    
+    // Starts a search from srcIdx in scratch
+    void resetScratch(SearchScratch& scratch, int srcIdx) const {
+        scratch.begin();
+        scratch.touch(srcIdx);
+        scratch.minCost[srcIdx] = 0;
+    }
+    
+    // Matrix worker: claims source rows until none are left, running one
+    // full single-source Dijkstra per row into its own scratch. Only reads
+    // the graph, so any number of workers can share it.
+    void fillMatrixRows(CostMatrix* matrix, unsigned short fromDay, atomic<unsigned int>* nextRow,
+                        atomic<bool>* outOfMemory) const {
+        SearchScratch* workspace = threadSearchScratch(totalPorts);
+        if (!workspace) {
+            *outOfMemory = true;
+            return;
+        }
+        SearchScratch& scratch = *workspace;
+        
+        RouteFilter noFilter;
+        for (unsigned int src = (*nextRow)++; src < totalPorts; src = (*nextRow)++) {
+            unsigned int nodesExplored = 0, routesFiltered = 0;
+            resetScratch(scratch, (int)src);
+            runCostSearch((int)src, -1, fromDay, false, NULL, noFilter, scratch,
+                          nodesExplored, routesFiltered);
+            
+            unsigned int* costRow = matrix->costRow(src);
+            unsigned int* hoursRow = matrix->hoursRow(src);
+            for (unsigned int to = 0; to < totalPorts; to++) {
+                scratch.touch(to);
+                costRow[to] = scratch.minCost[to];
+                hoursRow[to] = (scratch.minCost[to] == UINT_MAX) ? UINT_MAX : scratch.totalTime[to];
+            }
+        }
+    }
+    
+    // Batch worker: claims groups until none are left. A group shares source,
+    // date and preferences, so one Dijkstra tree answers all of it; the
+    // search stops once every destination in the group is settled.
+    void answerBatchGroups(const RouteQuery* queries, const int* order, const unsigned int* groupStart,
+                           unsigned int groupCount, RouteResult* results,
+                           atomic<unsigned int>* nextGroup, atomic<bool>* outOfMemory) const {
+        SearchScratch* workspace = threadSearchScratch(totalPorts);
+        unsigned int* mark = new (nothrow) unsigned int[totalPorts];
+        if (!workspace || !mark) {
+            delete[] mark;
+            *outOfMemory = true;
+            return;
+        }
+        SearchScratch& scratch = *workspace;
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            mark[p] = 0;
+        }
+        
+        for (unsigned int g = (*nextGroup)++; g < groupCount; g = (*nextGroup)++) {
+            const RouteQuery& head = queries[order[groupStart[g]]];
+            RouteFilter filter = resolvePreferences(head.prefs);
+            
+            SearchTargets targets;
+            targets.mark = mark;
+            targets.id = g + 1;
+            targets.remaining = 0;
+            for (unsigned int k = groupStart[g]; k < groupStart[g + 1]; k++) {
+                int dest = queries[order[k]].destIdx;
+                if (dest != filter.avoidPortIdx && mark[dest] != targets.id) {
+                    mark[dest] = targets.id;
+                    targets.remaining++;
+                }
+            }
+            
+            unsigned int nodesExplored = 0, routesFiltered = 0;
+            bool searched = (head.srcIdx != filter.avoidPortIdx && targets.remaining > 0);
+            if (searched) {
+                resetScratch(scratch, head.srcIdx);
+                runCostSearch(head.srcIdx, -1, dateToDayNumber(head.date), false, head.prefs, filter,
+                              scratch, nodesExplored, routesFiltered, &targets);
+            }
+            
+            for (unsigned int k = groupStart[g]; k < groupStart[g + 1]; k++) {
+                RouteResult& result = results[order[k]];
+                int dest = queries[order[k]].destIdx;
+                result.nodesExplored = nodesExplored;
+                result.routesFiltered = routesFiltered;
+                
+                if (!searched || dest == filter.avoidPortIdx) {
+                    result.status = QUERY_AVOIDS_ENDPOINT;
+                    continue;
+                }
+                scratch.touch(dest);
+                if (scratch.minCost[dest] == UINT_MAX) {
+                    result.status = QUERY_NO_ROUTE;
+                    continue;
+                }
+                
+                result.status = QUERY_FOUND;
+                result.cost = scratch.minCost[dest];
+                result.hours = scratch.totalTime[dest];
+                result.queueWaitHours = scratch.queueWaitTime[dest];
+                for (int curr = dest; curr != -1 && result.portCount < totalPorts; 
+                     curr = scratch.prevPort[curr]) {
+                    result.portCount++;
+                    result.dockingCharges += ports[curr].dailyDockingCharge;
+                }
+            }
+        }
+        delete[] mark;
+    }
+    
+    // Cost of the best src -> port -> dest path joining the forward label at
+    // port with the backward one, or UINT_MAX if they cannot be joined
+    unsigned int joinCost(const SearchScratch& fwd, const SearchScratch& bwd, unsigned int port,
+                          const UserPreferences* prefs) const {
+        if (fwd.minCost[port] == UINT_MAX || bwd.minCost[port] == UINT_MAX) return UINT_MAX;
+        if (fwd.usedRoute[port] && bwd.usedRoute[port] &&
+            !isValidConnection(fwd.usedRoute[port]->arrivalMins, bwd.usedRoute[port]->departureMins)) {
+            return UINT_MAX;
+        }
+        if (prefs && prefs->hasMaxTimeLimit &&
+            fwd.totalTime[port] + bwd.totalTime[port] > prefs->maxTimeLimit) {
+            return UINT_MAX;
+        }
+        unsigned long long cost = (unsigned long long)fwd.minCost[port] + bwd.minCost[port];
+        return cost < UINT_MAX ? (unsigned int)cost : UINT_MAX;
+    }
+    
+    // Dijkstra grown from both ends at once: forward from srcIdx over
+    // outgoing routes and backward from destIdx over the reverse view, always
+    // advancing the cheaper frontier. Route costs depend only on the route and
+    // its arrival port, so a backward label is exactly the cost of reaching
+    // destIdx from there. Stops once the two frontier minima add up to no
+    // less than the best joined path, then stitches the backward half into
+    // fwd so it reads like a one-sided search. False if memory ran out.
+    bool runBidirectionalSearch(int srcIdx, int destIdx, unsigned short fromDay,
+                                const UserPreferences* prefs, const RouteFilter& filter,
+                                SearchScratch& fwd, unsigned int& nodesExplored,
+                                unsigned int& routesFiltered) const {
+        SearchScratch* backScratch = threadSearchScratch(totalPorts, 1);
+        if (!backScratch) return false;
+        
+        // bwd.prevPort/usedRoute hold the next port and the route taken to it
+        SearchScratch& bwd = *backScratch;
+        resetScratch(bwd, destIdx);
+        PriorityQueue& forward = fwd.queue;
+        PriorityQueue& backward = bwd.queue;
+        forward.push(srcIdx, 0, 0);
+        backward.push(destIdx, 0, 0);
+        
+        unsigned int best = UINT_MAX;
+        int meet = -1;
+        
+        while (!forward.isEmpty() || !backward.isEmpty()) {
+            unsigned long long topF = forward.isEmpty() ? UINT_MAX : forward.topPriority();
+            unsigned long long topB = backward.isEmpty() ? UINT_MAX : backward.topPriority();
+            if (best != UINT_MAX && topF + topB >= best) break;
+            
+            bool goForward = topF <= topB;
+            SearchScratch& side = goForward ? fwd : bwd;
+            unsigned int currPort, currCost, unused;
+            if (!(goForward ? forward : backward).pop(currPort, currCost, unused)) break;
+            fwd.touch(currPort);
+            bwd.touch(currPort);
+            
+            if (side.visited[currPort]) continue;
+            side.visited[currPort] = true;
+            nodesExplored++;
+            
+            unsigned int begin = goForward ? csr.offsets[currPort] : csr.inOffsets[currPort];
+            unsigned int end = goForward ? csr.offsets[currPort + 1] : csr.inOffsets[currPort + 1];
+            for (unsigned int k = begin; k < end; k++) {
+                unsigned int e = goForward ? k : csr.inEdges[k];
+                if (csr.isCancelled(e)) continue;
+                unsigned int nextPort = goForward ? csr.destination[e] : csr.source[e];
+                unsigned int arrivalPort = csr.destination[e];
+                fwd.touch(nextPort);
+                bwd.touch(nextPort);
+                
+                // Backward routes must also never start from the avoided port
+                if (prefs && (!filter.passes(arrivalPort, csr.voyageCost[e], csr.companyId[e]) ||
+                              (int)nextPort == filter.avoidPortIdx)) {
+                    routesFiltered++;
+                    continue;
+                }
+                if (csr.voyageDay[e] < fromDay || side.visited[nextPort]) continue;
+                
+                RouteNode* joined = side.usedRoute[currPort];
+                if (joined && !(goForward ? isValidConnection(joined->arrivalMins, csr.departureMins[e])
+                                          : isValidConnection(csr.arrivalMins[e], joined->departureMins))) {
+                    continue;
+                }
+                
+                unsigned int queueWait = queueWaits.wait(arrivalPort);
+                unsigned int serviceTime = calculateServiceTime(csr.voyageCost[e]);
+                unsigned int newCost = side.minCost[currPort] + csr.voyageCost[e] + 
+                                       queueWaits.penalty(arrivalPort);
+                unsigned int newTotalTime = side.totalTime[currPort] + 
+                    voyageHours(csr.departureMins[e], csr.arrivalMins[e]) + 
+                    (queueWait / 60) + (serviceTime / 60);
+                
+                if (prefs && prefs->hasMaxTimeLimit && newTotalTime > prefs->maxTimeLimit) continue;
+                if (newCost >= side.minCost[nextPort]) continue;
+                
+                side.minCost[nextPort] = newCost;
+                side.totalTime[nextPort] = newTotalTime;
+                side.queueWaitTime[nextPort] = side.queueWaitTime[currPort] + (queueWait / 60);
+                side.prevPort[nextPort] = (int)currPort;
+                side.usedRoute[nextPort] = csr.route[e];
+                (goForward ? forward : backward).push(nextPort, newCost, 0);
+                
+                unsigned int total = joinCost(fwd, bwd, nextPort, prefs);
+                if (total < best) {
+                    best = total;
+                    meet = (int)nextPort;
+                }
+            }
+            
+            unsigned int total = joinCost(fwd, bwd, currPort, prefs);
+            if (total < best) {
+                best = total;
+                meet = (int)currPort;
+            }
+        }
+        
+        if (meet == -1) {
+            fwd.minCost[destIdx] = UINT_MAX;
+            return true;
+        }
+        
+        // Walk the backward half, extending the forward labels leg by leg
+        for (unsigned int curr = (unsigned int)meet, legs = 0; 
+             curr != (unsigned int)destIdx && legs < totalPorts; legs++) {
+            unsigned int next = (unsigned int)bwd.prevPort[curr];
+            fwd.touch(next);
+            fwd.minCost[next] = fwd.minCost[curr] + (bwd.minCost[curr] - bwd.minCost[next]);
+            fwd.totalTime[next] = fwd.totalTime[curr] + (bwd.totalTime[curr] - bwd.totalTime[next]);
+            fwd.queueWaitTime[next] = fwd.queueWaitTime[curr] + 
+                                      (bwd.queueWaitTime[curr] - bwd.queueWaitTime[next]);
+            fwd.prevPort[next] = (int)curr;
+            fwd.usedRoute[next] = bwd.usedRoute[curr];
+            curr = next;
+        }
+        return true;
+    }
+    
+    // Cheapest path through the contraction hierarchy, replayed leg by leg
+    // so scratch holds the same costs and times runCostSearch would. The
+    // query runs in scratch and this thread's second scratch slot, as the
+    // bidirectional search does. answered is false when raised routes leave
+    // the hierarchy unsure of the cheapest path and scratch is left reset
+    // for a full search. False if memory ran out.
+    bool runHierarchySearch(int srcIdx, int destIdx, SearchScratch& scratch,
+                            unsigned int& nodesExplored, bool& answered) const {
+        SearchScratch* backScratch = threadSearchScratch(totalPorts, 1);
+        if (!backScratch) return false;
+        
+        unsigned int* legEdges = scratch.path;
+        unsigned int legs;
+        unsigned int cost = hierarchy.query(srcIdx, destIdx, scratch, *backScratch, legEdges, 
+                                            totalPorts, legs, nodesExplored, answered);
+        resetScratch(scratch, srcIdx);     // the query's labels are not route labels
+        if (!answered || cost == UINT_MAX) return true;
+        
+        unsigned int curr = (unsigned int)srcIdx;
+        for (unsigned int i = 0; i < legs; i++) {
+            unsigned int e = legEdges[i];
+            unsigned int nextPort = csr.destination[e];
+            unsigned int queueWait = queueWaits.wait(nextPort);
+            unsigned int serviceTime = calculateServiceTime(csr.voyageCost[e]);
+            
+            scratch.touch(nextPort);
+            scratch.minCost[nextPort] = scratch.minCost[curr] + csr.voyageCost[e] + 
+                                        queueWaits.penalty(nextPort);
+            scratch.totalTime[nextPort] = scratch.totalTime[curr] + 
+                voyageHours(csr.departureMins[e], csr.arrivalMins[e]) + 
+                (queueWait / 60) + (serviceTime / 60);
+            scratch.queueWaitTime[nextPort] = scratch.queueWaitTime[curr] + (queueWait / 60);
+            scratch.prevPort[nextPort] = (int)curr;
+            scratch.usedRoute[nextPort] = csr.route[e];
+            curr = nextPort;
+        }
+        return true;
+    }
+
+    // Cheapest route from srcIdx to destIdx over routes sailing on or after
+    // preferredDate. Pure query: prints nothing and allocates nothing beyond
+    // scratch and this thread's second scratch slot (sized once, then kept),
+    // which the bidirectional and hierarchy searches use for their backward
+    // half. result.path and result.legs point into scratch, so they stay
+    // valid until scratch is reused.
+    void queryCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, int algorithm,
+                            const UserPreferences* prefs, SearchScratch& scratch,
+                            RouteResult& result) const {
+        result = RouteResult();
+        result.algorithm = algorithm;
+        
+        if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx)) {
+            result.status = QUERY_INVALID_PORT;
+            return;
+        }
+        if (!isValidDate(preferredDate)) {
+            result.status = QUERY_INVALID_DATE;
+            return;
+        }
+        if (srcIdx == destIdx) {
+            result.status = QUERY_SAME_PORT;
+            return;
+        }
+        
+        RouteFilter filter = resolvePreferences(prefs);
+        if (filter.avoidPortIdx != -1) {
+            if (srcIdx == filter.avoidPortIdx || destIdx == filter.avoidPortIdx) {
+                result.status = QUERY_AVOIDS_ENDPOINT;
+                return;
+            }
+        }
+        if (!csr.isBuilt() || !scratch.isValid()) {
+            result.status = QUERY_NO_MEMORY;
+            return;
+        }
+        unsigned short fromDay = dateToDayNumber(preferredDate);
+        
+        resetScratch(scratch, srcIdx);
+        
+        // Usable when an unfiltered search from fromDay would see exactly
+        // the routes the hierarchy was built over
+        bool useHierarchy = hierarchy.covers(fromDay) && !(prefs && prefs->hasAnyFilter()) &&
+                            algorithm != SEARCH_BIDIRECTIONAL;
+        if (useHierarchy &&
+            !runHierarchySearch(srcIdx, destIdx, scratch, result.nodesExplored, result.usedHierarchy)) {
+            result.status = QUERY_NO_MEMORY;
+            return;
+        }
+        if (!result.usedHierarchy) {
+            if (algorithm == SEARCH_BIDIRECTIONAL && csr.inOffsets && csr.source) {
+                if (!runBidirectionalSearch(srcIdx, destIdx, fromDay, prefs, filter, scratch,
+                                            result.nodesExplored, result.routesFiltered)) {
+                    result.status = QUERY_NO_MEMORY;
+                    return;
+                }
+            } else {
+                if (algorithm == SEARCH_BIDIRECTIONAL) {
+                    result.algorithm = SEARCH_DIJKSTRA;   // no reverse view to search back over
+                }
+                runCostSearch(srcIdx, destIdx, fromDay, algorithm == SEARCH_ASTAR, prefs, filter, 
+                              scratch, result.nodesExplored, result.routesFiltered);
+            }
+        }
+        
+        scratch.touch(destIdx);
+        if (scratch.minCost[destIdx] == UINT_MAX) {
+            result.status = QUERY_NO_ROUTE;
+            return;
+        }
+        
+        // Walk back from the destination, then flip to source-first order
+        unsigned int len = 0;
+        for (int curr = destIdx; curr != -1 && len < totalPorts; curr = scratch.prevPort[curr]) {
+            scratch.path[len] = curr;
+            scratch.pathRoutes[len] = scratch.usedRoute[curr];
+            len++;
+        }
+        for (unsigned int i = 0, j = len - 1; i < j; i++, j--) {
+            unsigned int port = scratch.path[i];
+            scratch.path[i] = scratch.path[j];
+            scratch.path[j] = port;
+        }
+        // pathRoutes[k] arrived at the port now at path[len - 1 - k], so the leg
+        // leaving path[i] is pathRoutes[len - 2 - i]; reverse the first len - 1
+        for (unsigned int i = 0, j = len - 2; len > 1 && i < j; i++, j--) {
+            RouteNode* leg = scratch.pathRoutes[i];
+            scratch.pathRoutes[i] = scratch.pathRoutes[j];
+            scratch.pathRoutes[j] = leg;
+        }
+        
+        result.status = QUERY_FOUND;
+        result.path = scratch.path;
+        result.legs = scratch.pathRoutes;
+        result.portCount = len;
+        result.cost = scratch.minCost[destIdx];
+        result.hours = scratch.totalTime[destIdx];
+        result.queueWaitHours = scratch.queueWaitTime[destIdx];
+        for (unsigned int i = 0; i < len; i++) {
+            result.dockingCharges += ports[scratch.path[i]].dailyDockingCharge;
+        }
+    }
+    
+    // Console report for a queryCheapestRoute result
+    void renderRouteResult(const RouteResult& result, int srcIdx, int destIdx, 
+                           const char* preferredDate, const UserPreferences* prefs) const {
+        switch (result.status) {
+            case QUERY_INVALID_PORT:
+                cout << "\n❌ Invalid port indices!\n";
+                return;
+            case QUERY_INVALID_DATE:
+                cout << "\n❌ Invalid date format!\n";
+                return;
+            case QUERY_SAME_PORT:
+                cout << "\n❌ Source and destination are the same!\n";
+                return;
+            case QUERY_AVOIDS_ENDPOINT:
+                cout << "\n❌ Cannot avoid source or destination port!\n";
+                return;
+            case QUERY_NO_MEMORY:
+                cout << "\n❌ Not enough memory for route search!\n";
+                return;
+            case QUERY_NO_ROUTE:
+                cout << "\n❌ No route found from " << ports[srcIdx].portName 
+                     << " to " << ports[destIdx].portName;
+                if (prefs && prefs->hasAnyFilter()) {
+                    cout << " matching your preferences";
+                }
+                cout << "\n";
+                if (result.routesFiltered > 0) {
+                    cout << "(" << result.routesFiltered << " routes filtered out by preferences)\n";
+                }
+                return;
+        }
         
-        // Now simulate ship arrivals in chronological order
-        cout << "Simulating port arrivals in chronological order...\n";
-        for (int i = 0; i < shipCount; i++) {
-            int destIdx = getPortIndex(allShips[i].destinationPort);
-            if (destIdx != -1) {
-                simulateShipArrival(destIdx, allShips[i]);
+        const char* algoName = "DIJKSTRA'S ALGORITHM";
+        if (result.usedHierarchy) {
+            algoName = "CONTRACTION HIERARCHY";
+        } else if (result.algorithm == SEARCH_ASTAR) {
+            algoName = "A* ALGORITHM";
+        } else if (result.algorithm == SEARCH_BIDIRECTIONAL) {
+            algoName = "BIDIRECTIONAL DIJKSTRA";
+        }
+        
+        cout << "\n========== " << algoName << " ==========\n";
+        cout << "From: " << ports[srcIdx].portName << "\n";
+        cout << "To: " << ports[destIdx].portName << "\n";
+        cout << "Date: " << preferredDate << "\n";
+        displayPreferences(prefs);
+        
+        cout << "Nodes Explored: " << result.nodesExplored << "/" << totalPorts;
+        if (result.routesFiltered > 0) {
+            cout << " (" << result.routesFiltered << " routes filtered)";
+        }
+        cout << "\n\n";
+        
+        const unsigned int* path = result.path;
+        RouteNode* const* legs = result.legs;
+        unsigned int last = result.portCount - 1;
+        
+        for (unsigned int i = 0; i <= last; i++) {
+            cout << ports[path[i]].portName;
+            
+            // Show queue status at intermediate ports (Option B - only if queue exists)
+            if (i > 0 && i < last) {  // Not source or destination
+                int queueSize = ports[path[i]].waitingQueue->getSize();
+                int occupied = ports[path[i]].dockedShips->size();
+                
+                if (queueSize > 0 || occupied > 0) {
+                    cout << "\n  Port Status:";
+                    cout << "\n    Docking: " << occupied << "/" << ports[path[i]].dockingSlots << " slots occupied";
+                    if (queueSize > 0) {
+                        cout << "\n    Queue: " << queueSize << " ships waiting";
+                        unsigned int waitTime = calculateQueueWaitTime(path[i]);
+                        if (waitTime > 0) {
+                            cout << "\n    Estimated wait: " << (waitTime / 60) << " hours";
+                        }
+                    }
+                }
+            }
+            
+            if (i < last && legs[i]) {
+                RouteNode* r = legs[i];
+                unsigned int serviceTime = calculateServiceTime(r->voyageCost);
+                char dateStr[MAX_DATE_LENGTH], depStr[MAX_TIME_LENGTH], arrStr[MAX_TIME_LENGTH];
+                dayNumberToDate(r->voyageDay, dateStr);
+                minutesToTime(r->departureMins, depStr);
+                minutesToTime(r->arrivalMins, arrStr);
+                
+                cout << "\n  ↓ [" << companies.name(r->companyId) << "] "
+                     << depStr << " (" << dateStr << ") "
+                     << "→ " << arrStr << " | $" << r->voyageCost;
+                cout << "\n    Service time: " << (serviceTime / 60) << " hours";
+                
+                if (i + 1 < last && legs[i + 1]) {
+                    int layover = calculateLayoverHours(r->arrivalMins, legs[i + 1]->departureMins);
+                    if (layover > 0) {
+                        cout << "\n    Layover: " << layover << "h";
+                        if (layover > 12) cout << " (Extended)";
+                    }
+                }
+                cout << "\n";
             }
         }
+
+        cout << "\n====================================\n";
+        cout << "Voyage Cost: $" << result.cost << "\n";
+        cout << "Total Time: " << result.hours << " hours\n";
+        if (result.queueWaitHours > 0) {
+            cout << "Queue Wait Time: " << result.queueWaitHours << " hours\n";
+        }
+        cout << "Port Charges: $" << result.dockingCharges << "\n";
+        cout << "TOTAL: $" << (result.cost + result.dockingCharges) << "\n";
+        cout << "====================================\n\n";
+    }
+
+    void findCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, 
+                          int algorithm = SEARCH_DIJKSTRA, const UserPreferences* prefs = NULL) {
+        // Routes.txt may have failed to load; search an empty network then
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
         
-        // Clean up
-        delete[] allShips;
+        SearchScratch* scratch = threadSearchScratch(totalPorts);
+        if (!scratch) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        // Only well-formed requests are worth a cache lookup
+        bool cacheable = isValidPortIndex(srcIdx) && isValidPortIndex(destIdx) && 
+                         isValidDate(preferredDate);
+        unsigned short day = cacheable ? dateToDayNumber(preferredDate) : 0;
+        const RouteResult* cached = cacheable ? 
+            routeCache.find(srcIdx, destIdx, day, algorithm, prefs, networkGeneration) : NULL;
+        if (cached) {
+            renderRouteResult(*cached, srcIdx, destIdx, preferredDate, prefs);
+            return;
+        }
         
-        cout << "Loaded " << loaded << " routes.\n";
-        cout << "Port queues initialized with " << shipCount << " ships (chronologically sorted).\n\n";
+        // A hierarchy built for another window of departure days is
+        // rebuilt over the routes this query can take, and kept for the next
+        if (cacheable && hierarchy.isBuilt() && !hierarchy.covers(day) && 
+            !(prefs && prefs->hasAnyFilter()) && algorithm != SEARCH_BIDIRECTIONAL) {
+            cout << "\nRebuilding the contraction hierarchy for sailings from " << preferredDate << "...\n";
+            if (!queueWaits.costPenalty || !hierarchy.build(csr, queueWaits.costPenalty, day)) {
+                cout << "❌ Could not rebuild it - this and later queries use A*/Dijkstra.\n";
+            }
+        }
+        
+        RouteResult result;
+        queryCheapestRoute(srcIdx, destIdx, preferredDate, algorithm, prefs, *scratch, result);
+        if (cacheable && (result.status == QUERY_FOUND || result.status == QUERY_NO_ROUTE)) {
+            routeCache.store(srcIdx, destIdx, day, algorithm, prefs, networkGeneration, result);
+        }
+        renderRouteResult(result, srcIdx, destIdx, preferredDate, prefs);
     }
 
-    void displayGraph() const {
-        if (totalPorts == 0) {
-            cout << "\nNo ports loaded!\n";
+    // Walks the path a search left in scratch back from destIdx. Every leg
+    // must be a route in its origin's list that ends where the path says
+    // and sails on or after fromDay, and the legs must add up to the label.
+    // cost is the label (UINT_MAX if unreachable); false if the path is bad.
+    bool checkSearchPath(SearchScratch& scratch, int srcIdx, int destIdx, unsigned short fromDay,
+                         unsigned int& cost) const {
+        scratch.touch(destIdx);
+        cost = scratch.minCost[destIdx];
+        if (cost == UINT_MAX) return true;
+        
+        unsigned int sum = 0, legs = 0;
+        for (int curr = destIdx; curr != srcIdx; curr = scratch.prevPort[curr]) {
+            int prev = scratch.prevPort[curr];
+            const RouteNode* leg = scratch.usedRoute[curr];
+            if (prev < 0 || !leg || ++legs >= totalPorts || 
+                leg->destinationIndex != (unsigned int)curr || leg->voyageDay < fromDay) {
+                return false;
+            }
+            const RouteNode* r = ports[prev].routeListHead;
+            while (r && r != leg) r = r->nextRoute;
+            if (!r) return false;
+            sum += leg->voyageCost + queueWaits.penalty(curr);
+        }
+        return sum == cost;
+    }
+    
+    // Tallies one engine's answer for srcIdx -> destIdx against Dijkstra's
+    void checkEngine(EngineCheck& check, SearchScratch& scratch, int srcIdx, int destIdx,
+                     unsigned short fromDay, unsigned int expected) const {
+        check.pairs++;
+        unsigned int cost;
+        bool validPath = checkSearchPath(scratch, srcIdx, destIdx, fromDay, cost);
+        if (validPath && cost == expected) return;
+        if (++check.mismatches > MAX_REPORTED_ERRORS) return;
+        
+        cout << "  ❌ " << check.name << " " << ports[srcIdx].portName << " → " 
+             << ports[destIdx].portName << ": ";
+        if (!validPath) {
+            cout << "path is not a chain of live routes";
+        } else if (cost == UINT_MAX) {
+            cout << "no route, Dijkstra $" << expected;
+        } else if (expected == UINT_MAX) {
+            cout << "$" << cost << ", Dijkstra found no route";
+        } else {
+            cout << "$" << cost << ", Dijkstra $" << expected;
+        }
+        cout << "\n";
+    }
+    
+    // Self-check: runs every cheapest-route engine over all port pairs
+    // (evenly sampled sources past VERIFY_MAX_PAIRS) with the routes the
+    // hierarchy was built over (every route if there is none), and compares
+    // each answer with plain Dijkstra.
+    // A pair fails if the cost differs or the path does not hold up.
+    void verifySearchEngines() {
+        cout << "\n--- Search Engine Self-Check ---\n";
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "❌ Not enough memory for route search!\n";
+            return;
+        }
+        SearchScratch* workspace = threadSearchScratch(totalPorts);
+        unsigned int* reference = new (nothrow) unsigned int[totalPorts + 1];
+        if (!workspace || !reference) {
+            delete[] reference;
+            cout << "❌ Not enough memory for route search!\n";
             return;
         }
+        SearchScratch& scratch = *workspace;
         
-        cout << "\n========== PORT NETWORK ==========\n\n";
-        for (unsigned char i = 0; i < totalPorts; i++) {
-            cout << ports[i].portName << " ($" << ports[i].dailyDockingCharge << "/day)\n";
-            cout << "  Docking: " << ports[i].occupiedSlots << "/" << DOCKING_SLOTS << " slots occupied\n";
-            ports[i].waitingQueue->display();
+        unsigned long long allPairs = (unsigned long long)totalPorts * (totalPorts - 1);
+        unsigned int stride = (unsigned int)((allPairs + VERIFY_MAX_PAIRS - 1) / VERIFY_MAX_PAIRS);
+        if (stride == 0) stride = 1;
+        const unsigned short fromDay = hierarchy.isBuilt() ? hierarchy.getFromDay() : 
+                                                             CANCELLED_DAY + 1;
+        
+        EngineCheck dijkstra("Dijkstra"), astar("A*"), bidirectional("Bidirectional Dijkstra");
+        EngineCheck contracted("Contraction hierarchy");
+        bool reverseView = csr.buildDepartureOrder() && csr.buildReverse();
+        RouteFilter noFilter;
+        unsigned int explored = 0, filtered = 0;
+        bool outOfMemory = false;
+        
+        for (unsigned int s = 0; s < totalPorts && !outOfMemory; s += stride) {
+            resetScratch(scratch, (int)s);
+            runCostSearch((int)s, -1, fromDay, false, NULL, noFilter, scratch, explored, filtered);
+            for (unsigned int t = 0; t < totalPorts; t++) {
+                if (t == s) continue;
+                scratch.touch(t);
+                reference[t] = scratch.minCost[t];
+                checkEngine(dijkstra, scratch, (int)s, (int)t, fromDay, reference[t]);
+            }
             
-            RouteNode* route = ports[i].routeListHead;
-            if (!route) {
-                cout << "  No outgoing routes\n";
-            } else {
-                cout << "  Outgoing routes:\n";
-                while (route) {
-                    cout << "    → " << ports[route->destinationIndex].portName
-                         << " | " << route->voyageDate
-                         << " | " << route->departureTime << "-" << route->arrivalTime
-                         << " | $" << route->voyageCost
-                         << " | " << route->shippingCompany << "\n";
-                    route = route->nextRoute;
+            for (unsigned int t = 0; t < totalPorts && !outOfMemory; t++) {
+                if (t == s) continue;
+                resetScratch(scratch, (int)s);
+                runCostSearch((int)s, (int)t, fromDay, true, NULL, noFilter, scratch, explored, filtered);
+                checkEngine(astar, scratch, (int)s, (int)t, fromDay, reference[t]);
+                
+                if (reverseView) {
+                    resetScratch(scratch, (int)s);
+                    outOfMemory = !runBidirectionalSearch((int)s, (int)t, fromDay, NULL, noFilter,
+                                                          scratch, explored, filtered);
+                    if (outOfMemory) break;
+                    checkEngine(bidirectional, scratch, (int)s, (int)t, fromDay, reference[t]);
+                }
+                
+                if (hierarchy.isBuilt()) {
+                    bool answered;
+                    outOfMemory = !runHierarchySearch((int)s, (int)t, scratch, explored, answered);
+                    if (outOfMemory) break;
+                    if (answered) {
+                        checkEngine(contracted, scratch, (int)s, (int)t, fromDay, reference[t]);
+                    } else {
+                        contracted.fellBack++;
+                    }
                 }
             }
+        }
+        delete[] reference;
+        if (outOfMemory) {
+            cout << "❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        cout << "Checked " << dijkstra.pairs << " port pairs";
+        if (stride > 1) cout << " (1 in " << stride << " source ports)";
+        cout << ":\n";
+        const EngineCheck* checks[] = { &dijkstra, &astar, &bidirectional, &contracted };
+        unsigned int mismatches = 0;
+        for (int i = 0; i < 4; i++) {
+            const EngineCheck& check = *checks[i];
+            mismatches += check.mismatches;
+            cout << "  " << check.name << ": ";
+            if (check.pairs == 0 && check.fellBack == 0) {
+                cout << (&check == &contracted ? "not built (option 7)\n" : "no memory for its index\n");
+                continue;
+            }
+            cout << check.pairs << " pairs, " << check.mismatches << " mismatched";
+            if (check.fellBack > 0) cout << ", " << check.fellBack << " left to a full search";
             cout << "\n";
         }
+        if (mismatches == 0) {
+            cout << "✅ Every engine agrees with Dijkstra.\n";
+        } else {
+            cout << "❌ " << mismatches << " mismatched answers.\n";
+        }
+    }
+    
+    // First part of the loaded network where other differs from this one,
+    // or NULL if the two match: ports, routes as the searches read them,
+    // simulated queues and landmark tables
+    const char* networkDifference(const Graph& other) const {
+        if (totalPorts != other.totalPorts) return "port count";
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            if (strcmp(ports[p].portName, other.ports[p].portName) != 0) return "port names";
+            if (ports[p].dailyDockingCharge != other.ports[p].dailyDockingCharge ||
+                ports[p].dockingSlots != other.ports[p].dockingSlots) return "port charges or berths";
+        }
+        
+        if (!csr.isBuilt() || !other.csr.isBuilt() || csr.edgeCount != other.csr.edgeCount) {
+            return "route count";
+        }
+        for (unsigned int p = 0; p <= totalPorts; p++) {
+            if (csr.offsets[p] != other.csr.offsets[p]) return "routes per port";
+        }
+        for (unsigned int e = 0; e < csr.edgeCount; e++) {
+            if (csr.destination[e] != other.csr.destination[e] ||
+                csr.departureMins[e] != other.csr.departureMins[e] ||
+                csr.arrivalMins[e] != other.csr.arrivalMins[e] ||
+                csr.voyageCost[e] != other.csr.voyageCost[e] ||
+                csr.voyageDay[e] != other.csr.voyageDay[e] ||
+                strcmp(companies.name(csr.companyId[e]), 
+                       other.companies.name(other.csr.companyId[e])) != 0) return "route details";
+        }
+        
+        if (arrivalsSimulated != other.arrivalsSimulated) return "simulated arrivals";
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            if (ports[p].waitingQueue->getSize() != other.ports[p].waitingQueue->getSize() ||
+                queueWaits.wait(p) != other.queueWaits.wait(p)) return "port queues";
+        }
+        if (!landmarks.sameAs(other.landmarks)) return "landmark tables";
+        return NULL;
+    }
+    
+    // Self-check of the load paths. Routes.txt is read again on one thread
+    // and in VERIFY_LOADER_CHUNKS parallel chunks, and the single-thread
+    // load is written to a snapshot and read back; all three must give the
+    // same network. Reads the text files, not this (possibly updated) graph.
+    void verifyNetworkLoading() const {
+        cout << "\n--- Loader Self-Check ---\n";
+        ostringstream quiet;
+        Graph serial, chunked, restored;
+        serial.setLog(quiet);
+        chunked.setLog(quiet);
+        restored.setLog(quiet);
+        
+        serial.loadPortCharges();
+        serial.loadRoutes(1);
+        if (serial.totalPorts == 0) {
+            cout << "❌ No ports loaded from PortCharges.txt!\n";
+            return;
+        }
+        chunked.loadPortCharges();
+        chunked.loadRoutes(VERIFY_LOADER_CHUNKS);
+        
+        FileStamp chargesStamp = stampFile("PortCharges.txt");
+        FileStamp routesStamp = stampFile("Routes.txt");
+        bool saved = serial.saveSnapshot(SELF_CHECK_SNAPSHOT_FILE, chargesStamp, routesStamp);
+        bool restoredOk = saved && 
+            restored.loadSnapshot(SELF_CHECK_SNAPSHOT_FILE, chargesStamp, routesStamp);
+        remove(SELF_CHECK_SNAPSHOT_FILE);
+        
+        const char* chunkedDiff = chunked.networkDifference(serial);
+        const char* restoredDiff = restoredOk ? restored.networkDifference(serial) : NULL;
+        cout << "Loaded " << serial.totalPorts << " ports and " << serial.csr.liveEdgeCount() 
+             << " routes on one thread.\n";
+        cout << "  Parallel load (" << VERIFY_LOADER_CHUNKS << " chunks): ";
+        if (chunkedDiff) cout << "❌ differs in " << chunkedDiff << "\n";
+        else cout << "same network\n";
+        cout << "  Snapshot round-trip: ";
+        if (!saved) cout << "❌ could not write " << SELF_CHECK_SNAPSHOT_FILE << "\n";
+        else if (!restoredOk) cout << "❌ could not read it back\n";
+        else if (restoredDiff) cout << "❌ differs in " << restoredDiff << "\n";
+        else cout << "same network\n";
+        
+        if (!chunkedDiff && restoredOk && !restoredDiff) {
+            cout << "✅ Every load path gives the same network.\n";
+        } else {
+            cout << "❌ The load paths disagree.\n";
+        }
     }
 
-    void findCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, 
-                          bool useAStar = false, const UserPreferences* prefs = NULL) {
+    // Earliest arrival over the actual timetable (connection scan). Sailings
+    // are scanned in departure order; one can be taken only if its origin
+    // has been reached and the cargo is ready (arrival + queue wait + service)
+    // by its departure minute. Each port keeps a single ready-time label, so
+    // the work is one pass over the sailings leaving on or after the date.
+    void findEarliestArrival(int srcIdx, int destIdx, const char* preferredDate,
+                             const UserPreferences* prefs = NULL) {
         if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx)) {
             cout << "\n❌ Invalid port indices!\n";
             return;
         }
         
-        if (!isValidDateFormat(preferredDate)) {
+        if (!isValidDate(preferredDate)) {
             cout << "\n❌ Invalid date format!\n";
             return;
         }
@@ -702,116 +5933,283 @@ public:
             return;
         }
         
-        if (prefs && prefs->hasAvoidPort) {
-            if (strcmp(ports[srcIdx].portName, prefs->avoidPort) == 0 ||
-                strcmp(ports[destIdx].portName, prefs->avoidPort) == 0) {
+        RouteFilter filter = resolvePreferences(prefs);
+        if (filter.avoidPortIdx != -1) {
+            if (srcIdx == filter.avoidPortIdx || destIdx == filter.avoidPortIdx) {
                 cout << "\n❌ Cannot avoid source or destination port!\n";
                 return;
             }
         }
-
-        const char* algoName = useAStar ? "A* ALGORITHM" : "DIJKSTRA'S ALGORITHM";
+        unsigned int startMinute = departureMinute(dateToDayNumber(preferredDate), 0);
+        
+        if ((!csr.isBuilt() && !csr.build(ports, totalPorts)) || !csr.buildDepartureOrder()) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
         
-        unsigned int minCost[MAX_PORTS];
-        unsigned int totalTime[MAX_PORTS];
-        unsigned int queueWaitTime[MAX_PORTS];
-        bool visited[MAX_PORTS] = {false};
-        char prevPort[MAX_PORTS];
-        RouteNode* usedRoute[MAX_PORTS] = {NULL};
-        unsigned int nodesExplored = 0;
+        SearchScratch* workspace = threadSearchScratch(totalPorts);
+        if (!workspace) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        SearchScratch& scratch = *workspace;
+        unsigned int* readyAt = scratch.minCost;    // minute cargo can sail on
+        int* viaEdge = scratch.viaEdge;             // sailing that reached each port
+        unsigned int destArrival = UINT_MAX;
+        int destEdge = -1;
+        unsigned int connectionsScanned = 0;
         unsigned int routesFiltered = 0;
-
-        for (unsigned char i = 0; i < totalPorts; i++) {
-            minCost[i] = UINT_MAX;
-            totalTime[i] = 0;
-            queueWaitTime[i] = 0;
-            prevPort[i] = -1;
+        
+        scratch.begin();
+        scratch.touch(srcIdx);
+        readyAt[srcIdx] = startMinute;
+        
+        // First sailing leaving on or after the start of the date
+        const int* order = csr.byDeparture;
+        unsigned int lo = 0, hi = csr.edgeCount;
+        while (lo < hi) {
+            unsigned int mid = lo + (hi - lo) / 2;
+            unsigned int e = (unsigned int)order[mid];
+            if (departureMinute(csr.voyageDay[e], csr.departureMins[e]) < startMinute) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
         }
-        minCost[srcIdx] = 0;
-
-        PriorityQueue pq;
         
-        if (useAStar) {
-            unsigned int h = calculateHeuristic(srcIdx, destIdx);
-            pq.push(srcIdx, 0, h);
-        } else {
-            pq.push(srcIdx, 0, 0);
+        for (unsigned int k = lo; k < csr.edgeCount; k++) {
+            unsigned int e = (unsigned int)order[k];
+            if (csr.isCancelled(e)) continue;
+            unsigned int departs = departureMinute(csr.voyageDay[e], csr.departureMins[e]);
+            if (departs >= destArrival) break;   // nothing later can arrive sooner
+            connectionsScanned++;
+            
+            unsigned int from = csr.source[e];
+            scratch.touch(from);
+            if (readyAt[from] > departs) continue;
+            
+            unsigned int nextPort = csr.destination[e];
+            if (prefs && !filter.passes(nextPort, csr.voyageCost[e], csr.companyId[e])) {
+                routesFiltered++;
+                continue;
+            }
+            
+            unsigned int arrives = arrivalMinute(csr.voyageDay[e], csr.departureMins[e], 
+                                                 csr.arrivalMins[e]);
+            if (nextPort == (unsigned int)destIdx) {
+                if (arrives < destArrival) {
+                    destArrival = arrives;
+                    destEdge = (int)e;
+                }
+                continue;
+            }
+            
+            unsigned int ready = arrives + 
+                queueWaits.wait(nextPort) +
+                calculateServiceTime(csr.voyageCost[e]);
+            scratch.touch(nextPort);
+            if (ready < readyAt[nextPort]) {
+                readyAt[nextPort] = ready;
+                viaEdge[nextPort] = (int)e;
+            }
         }
-
-        while (!pq.isEmpty()) {
-            unsigned char currPort;
-            unsigned int currCost, currHeuristic;
+        
+        bool withinTimeLimit = true;
+        if (destEdge != -1 && prefs && prefs->hasMaxTimeLimit) {
+            withinTimeLimit = ((destArrival - startMinute) / 60 <= (unsigned int)prefs->maxTimeLimit);
+        }
+        
+        if (destEdge == -1 || !withinTimeLimit) {
+            cout << "\n❌ No scheduled connection from " << ports[srcIdx].portName 
+                 << " to " << ports[destIdx].portName;
+            if (prefs && prefs->hasAnyFilter()) {
+                cout << " matching your preferences";
+            }
+            cout << "\n";
+            if (routesFiltered > 0) {
+                cout << "(" << routesFiltered << " routes filtered out by preferences)\n";
+            }
+            return;
+        }
+        
+        // Walk the sailings back from the destination
+        RouteNode** legs = scratch.pathRoutes;
+        unsigned int* legEdges = scratch.path;
+        unsigned int len = 0;
+        for (int e = destEdge; e != -1 && len < totalPorts; e = viaEdge[csr.source[e]]) {
+            legEdges[len] = (unsigned int)e;
+            legs[len] = csr.route[e];
+            len++;
+        }
+        
+        cout << "\n========== EARLIEST ARRIVAL (SCHEDULE) ==========\n";
+        cout << "From: " << ports[srcIdx].portName << "\n";
+        cout << "To: " << ports[destIdx].portName << "\n";
+        cout << "Date: " << preferredDate << "\n";
+        displayPreferences(prefs);
+        cout << "Connections Scanned: " << connectionsScanned << "/" << csr.edgeCount;
+        if (routesFiltered > 0) {
+            cout << " (" << routesFiltered << " routes filtered)";
+        }
+        cout << "\n\n";
+        
+        unsigned int voyageCost = 0;
+        unsigned int totalDocking = ports[srcIdx].dailyDockingCharge;
+        cout << ports[srcIdx].portName << "\n";
+        
+        for (int i = (int)len - 1; i >= 0; i--) {
+            unsigned int e = legEdges[i];
+            const RouteNode* r = legs[i];
+            char depDate[MAX_DATE_LENGTH], arrDate[MAX_DATE_LENGTH];
+            char depStr[MAX_TIME_LENGTH], arrStr[MAX_TIME_LENGTH];
+            unsigned int arrives = arrivalMinute(r->voyageDay, r->departureMins, r->arrivalMins);
+            dayNumberToDate(r->voyageDay, depDate);
+            dayNumberToDate((unsigned short)(arrives / 1440), arrDate);
+            minutesToTime(r->departureMins, depStr);
+            minutesToTime(r->arrivalMins, arrStr);
             
-            if (!pq.pop(currPort, currCost, currHeuristic)) break;
+            cout << "  ↓ [" << companies.name(r->companyId) << "] "
+                 << depStr << " (" << depDate << ") → " 
+                 << arrStr << " (" << arrDate << ") | $" << r->voyageCost << "\n";
             
-            if (visited[currPort]) continue;
-            visited[currPort] = true;
-            nodesExplored++;
-
-            if (currPort == destIdx) break;
+            unsigned int port = csr.destination[e];
+            cout << ports[port].portName << "\n";
+            if (i > 0) {
+                const RouteNode* next = legs[i - 1];
+                unsigned int departs = departureMinute(next->voyageDay, next->departureMins);
+                cout << "    Ready to sail after " << (readyAt[port] - arrives) / 60 
+                     << "h (queue + service), next sailing in " << (departs - arrives) / 60 << "h\n";
+            }
+            
+            voyageCost += r->voyageCost;
+            totalDocking += ports[port].dailyDockingCharge;
+        }
+        
+        char arrDate[MAX_DATE_LENGTH], arrStr[MAX_TIME_LENGTH];
+        dayNumberToDate((unsigned short)(destArrival / 1440), arrDate);
+        minutesToTime((unsigned short)(destArrival % 1440), arrStr);
+        
+        cout << "\n====================================\n";
+        cout << "Arrival: " << arrStr << " (" << arrDate << ")\n";
+        cout << "Elapsed Time: " << (destArrival - startMinute) / 60 << " hours\n";
+        cout << "Voyage Cost: $" << voyageCost << "\n";
+        cout << "Port Charges: $" << totalDocking << "\n";
+        cout << "TOTAL: $" << (voyageCost + totalDocking) << "\n";
+        cout << "====================================\n\n";
+    }
 
-            RouteNode* route = ports[currPort].routeListHead;
-            while (route) {
-                unsigned char nextPort = route->destinationIndex;
-                
-                bool passesFilter = true;
-                if (prefs) {
-                    passesFilter = matchesPreferences(route, nextPort, *prefs);
-                    if (!passesFilter) {
-                        routesFiltered++;
-                    }
-                }
-                
-                if (passesFilter && isSameDateOrLater(route->voyageDate, preferredDate)) {
-                    bool timeValid = true;
-                    if (prevPort[currPort] != -1 && usedRoute[currPort]) {
-                        timeValid = isValidConnection(
-                            usedRoute[currPort]->arrivalMins,
-                            route->departureMins
-                        );
-                    }
-                    
-                    if (timeValid && !visited[nextPort]) {
-                        // Calculate queue wait time at next port (Option A - affects cost)
-                        unsigned int queueWait = calculateQueueWaitTime(
-                            nextPort, route->voyageDate, route->arrivalMins);
-                        unsigned int serviceTime = calculateServiceTime(route->voyageCost);
-                        
-                        // Add queue wait time to cost calculation
-                        unsigned int queueCostPenalty = (queueWait / 60) * 
-                                                       ports[nextPort].dailyDockingCharge / 24;
-                        unsigned int newCost = minCost[currPort] + route->voyageCost + queueCostPenalty;
-                        
-                        unsigned int voyageTime = calculateVoyageTime(route);
-                        unsigned int newTotalTime = totalTime[currPort] + voyageTime + 
-                                                   (queueWait / 60) + (serviceTime / 60);
-                        
-                        bool withinTimeLimit = true;
-                        if (prefs && prefs->hasMaxTimeLimit) {
-                            withinTimeLimit = (newTotalTime <= prefs->maxTimeLimit);
-                        }
-                        
-                        if (withinTimeLimit && newCost < minCost[nextPort]) {
-                            minCost[nextPort] = newCost;
-                            totalTime[nextPort] = newTotalTime;
-                            queueWaitTime[nextPort] = queueWaitTime[currPort] + (queueWait / 60);
-                            prevPort[nextPort] = currPort;
-                            usedRoute[nextPort] = route;
-                            
-                            if (useAStar) {
-                                unsigned int h = calculateHeuristic(nextPort, destIdx);
-                                pq.push(nextPort, newCost, newCost + h);
-                            } else {
-                                pq.push(nextPort, newCost, 0);
-                            }
-                        }
-                    }
+    // Every itinerary no other beats on voyage cost, total hours and number
+    // of legs at once, using the same cost and time model as
+    // findCheapestRoute. Labels are settled in lexicographic order; a new
+    // label is dropped if a label at its port or a finished itinerary is at
+    // least as good on all three.
+    void findParetoRoutes(int srcIdx, int destIdx, const char* preferredDate,
+                          const UserPreferences* prefs = NULL) {
+        if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx)) {
+            cout << "\n❌ Invalid port indices!\n";
+            return;
+        }
+        
+        if (!isValidDate(preferredDate)) {
+            cout << "\n❌ Invalid date format!\n";
+            return;
+        }
+        
+        if (srcIdx == destIdx) {
+            cout << "\n❌ Source and destination are the same!\n";
+            return;
+        }
+        
+        RouteFilter filter = resolvePreferences(prefs);
+        if (filter.avoidPortIdx != -1) {
+            if (srcIdx == filter.avoidPortIdx || destIdx == filter.avoidPortIdx) {
+                cout << "\n❌ Cannot avoid source or destination port!\n";
+                return;
+            }
+        }
+        unsigned short fromDay = dateToDayNumber(preferredDate);
+        
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        LabelSet labels(totalPorts);
+        LabelHeap heap;
+        int* frontier = new (nothrow) int[MAX_LABELS_PER_PORT];
+        if (!labels.isValid() || !frontier) {
+            delete[] frontier;
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        int frontierSize = 0;
+        unsigned int labelsSettled = 0;
+        unsigned int labelsDropped = 0;     // over MAX_LABELS_PER_PORT
+        unsigned int routesFiltered = 0;
+        bool outOfMemory = false;
+        
+        int start = labels.add(srcIdx, 0, 0, 0, -1, -1);
+        if (start == -1 || !heap.push(labels[start], start)) outOfMemory = true;
+        
+        while (!outOfMemory && !heap.isEmpty()) {
+            int id = heap.pop();
+            if (!labels[id].alive) continue;
+            labelsSettled++;
+            
+            Label current = labels[id];
+            if (current.port == (unsigned int)destIdx) {
+                if (frontierSize < MAX_LABELS_PER_PORT) frontier[frontierSize++] = id;
+                continue;
+            }
+            
+            const unsigned int edgeEnd = csr.offsets[current.port + 1];
+            for (unsigned int e = csr.offsets[current.port]; e < edgeEnd; e++) {
+                unsigned int nextPort = csr.destination[e];
+                if (csr.isCancelled(e) || csr.voyageDay[e] < fromDay) continue;
+                if (prefs && !filter.passes(nextPort, csr.voyageCost[e], csr.companyId[e])) {
+                    routesFiltered++;
+                    continue;
+                }
+                
+                unsigned int queueWait = queueWaits.wait(nextPort);
+                unsigned int serviceTime = calculateServiceTime(csr.voyageCost[e]);
+                
+                unsigned int cost = current.cost + csr.voyageCost[e] + queueWaits.penalty(nextPort);
+                unsigned int hours = current.hours + 
+                    voyageHours(csr.departureMins[e], csr.arrivalMins[e]) +
+                    (queueWait / 60) + (serviceTime / 60);
+                unsigned int legs = current.legs + 1;
+                
+                if (prefs && prefs->hasMaxTimeLimit && hours > (unsigned int)prefs->maxTimeLimit) {
+                    continue;
+                }
+                if (labels.isDominated(destIdx, cost, hours, legs) ||
+                    labels.isDominated(nextPort, cost, hours, legs)) {
+                    continue;
+                }
+                
+                int next = labels.add(nextPort, cost, hours, legs, id, (int)e);
+                if (next == -1) {
+                    labelsDropped++;
+                    continue;
+                }
+                if (!heap.push(labels[next], next)) {
+                    outOfMemory = true;
+                    break;
                 }
-                route = route->nextRoute;
             }
         }
-
-        if (minCost[destIdx] == UINT_MAX) {
+        
+        if (outOfMemory) {
+            delete[] frontier;
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
+        
+        if (frontierSize == 0) {
+            delete[] frontier;
             cout << "\n❌ No route found from " << ports[srcIdx].portName 
                  << " to " << ports[destIdx].portName;
             if (prefs && prefs->hasAnyFilter()) {
@@ -823,97 +6221,63 @@ public:
             }
             return;
         }
-
-        unsigned char path[MAX_PORTS];
-        RouteNode* routes[MAX_PORTS];
-        unsigned char len = 0;
         
-        for (char curr = destIdx; curr != -1 && len < MAX_PORTS; curr = prevPort[curr]) {
-            path[len] = curr;
-            routes[len] = usedRoute[curr];
-            len++;
+        unsigned int fastest = UINT_MAX, fewestLegs = UINT_MAX;
+        for (int i = 0; i < frontierSize; i++) {
+            if (labels[frontier[i]].hours < fastest) fastest = labels[frontier[i]].hours;
+            if (labels[frontier[i]].legs < fewestLegs) fewestLegs = labels[frontier[i]].legs;
         }
-
-        cout << "\n========== " << algoName << " ==========\n";
+        
+        cout << "\n========== PARETO ROUTES (COST / TIME / LEGS) ==========\n";
         cout << "From: " << ports[srcIdx].portName << "\n";
         cout << "To: " << ports[destIdx].portName << "\n";
         cout << "Date: " << preferredDate << "\n";
-        
-        if (prefs && prefs->hasAnyFilter()) {
-            if (prefs->hasCompanyFilter) {
-                cout << "Company Filter: " << prefs->preferredCompany << "\n";
-            }
-            if (prefs->hasAvoidPort) {
-                cout << "Avoiding Port: " << prefs->avoidPort << "\n";
-            }
-            if (prefs->hasMaxCostLimit) {
-                cout << "Max Cost Limit: $" << prefs->maxCostLimit << "\n";
-            }
-            if (prefs->hasMaxTimeLimit) {
-                cout << "Max Time Limit: " << prefs->maxTimeLimit << " hours\n";
-            }
+        displayPreferences(prefs);
+        cout << "Labels Settled: " << labelsSettled << " (" << labels.size() << " created";
+        if (labelsDropped > 0) {
+            cout << ", " << labelsDropped << " dropped at the per-port limit";
         }
-        
-        cout << "Nodes Explored: " << nodesExplored << "/" << (int)totalPorts;
+        cout << ")\n";
         if (routesFiltered > 0) {
-            cout << " (" << routesFiltered << " routes filtered)";
+            cout << "(" << routesFiltered << " routes filtered)\n";
         }
-        cout << "\n\n";
-
-        unsigned int totalDocking = 0;
+        cout << "Non-dominated itineraries: " << frontierSize << "\n";
         
-        for (int i = len - 1; i >= 0; i--) {
-            cout << ports[path[i]].portName;
-            totalDocking += ports[path[i]].dailyDockingCharge;
+        // The frontier comes out cheapest first
+        for (int i = 0; i < frontierSize; i++) {
+            const Label& found = labels[frontier[i]];
             
-            // Show queue status at intermediate ports (Option B - only if queue exists)
-            if (i > 0 && i < len - 1) {  // Not source or destination
-                int queueSize = ports[path[i]].waitingQueue->getSize();
-                int occupied = ports[path[i]].occupiedSlots;
-                
-                if (queueSize > 0 || occupied > 0) {
-                    cout << "\n  Port Status:";
-                    cout << "\n    Docking: " << occupied << "/" << DOCKING_SLOTS << " slots occupied";
-                    if (queueSize > 0) {
-                        cout << "\n    Queue: " << queueSize << " ships waiting";
-                        unsigned int waitTime = calculateQueueWaitTime(path[i], 
-                            routes[i-1]->voyageDate, routes[i-1]->arrivalMins);
-                        if (waitTime > 0) {
-                            cout << "\n    Estimated wait: " << (waitTime / 60) << " hours";
-                        }
-                    }
-                }
-            }
+            cout << "\nOption " << (i + 1) << ": $" << found.cost << " | " 
+                 << found.hours << " hours | " << found.legs << (found.legs == 1 ? " leg" : " legs");
+            if (i == 0) cout << " [cheapest]";
+            if (found.hours == fastest) cout << " [fastest]";
+            if (found.legs == fewestLegs) cout << " [fewest legs]";
+            cout << "\n";
             
-            if (i > 0 && routes[i-1]) {
-                RouteNode* r = routes[i-1];
-                unsigned int serviceTime = calculateServiceTime(r->voyageCost);
-                
-                cout << "\n  ↓ [" << r->shippingCompany << "] "
-                     << r->departureTime << " (" << r->voyageDate << ") "
-                     << "→ " << r->arrivalTime << " | $" << r->voyageCost;
-                cout << "\n    Service time: " << (serviceTime / 60) << " hours";
-                
-                if (i > 1 && routes[i-2]) {
-                    int layover = calculateLayoverHours(r->arrivalMins, routes[i-2]->departureMins);
-                    if (layover > 0) {
-                        cout << "\n    Layover: " << layover << "h";
-                        if (layover > 12) cout << " (Extended)";
-                    }
+            // Legs are linked destination-first; print them source-first
+            unsigned int totalDocking = ports[destIdx].dailyDockingCharge;
+            for (unsigned int leg = found.legs; leg > 0; leg--) {
+                int step = frontier[i];
+                for (unsigned int k = 1; k < leg; k++) {
+                    step = labels[step].parent;
                 }
-                cout << "\n";
+                const RouteNode* r = csr.route[labels[step].edge];
+                unsigned int from = labels[labels[step].parent].port;
+                char dateStr[MAX_DATE_LENGTH], depStr[MAX_TIME_LENGTH], arrStr[MAX_TIME_LENGTH];
+                dayNumberToDate(r->voyageDay, dateStr);
+                minutesToTime(r->departureMins, depStr);
+                minutesToTime(r->arrivalMins, arrStr);
+                
+                cout << "  " << ports[from].portName << " → " << ports[labels[step].port].portName
+                     << " [" << companies.name(r->companyId) << "] " << depStr << " (" << dateStr 
+                     << ") → " << arrStr << " | $" << r->voyageCost << "\n";
+                totalDocking += ports[from].dailyDockingCharge;
             }
+            cout << "  Port Charges: $" << totalDocking << " | TOTAL: $" 
+                 << (found.cost + totalDocking) << "\n";
         }
-
-        cout << "\n====================================\n";
-        cout << "Voyage Cost: $" << minCost[destIdx] << "\n";
-        cout << "Total Time: " << totalTime[destIdx] << " hours\n";
-        if (queueWaitTime[destIdx] > 0) {
-            cout << "Queue Wait Time: " << queueWaitTime[destIdx] << " hours\n";
-        }
-        cout << "Port Charges: $" << totalDocking << "\n";
-        cout << "TOTAL: $" << (minCost[destIdx] + totalDocking) << "\n";
-        cout << "====================================\n\n";
+        cout << "\n========================================================\n\n";
+        delete[] frontier;
     }
 
     UserPreferences getUserPreferences() {
@@ -974,18 +6338,20 @@ public:
     }
 
     void displayPortQueueStatus() const {
-        cout << "\n========== PORT QUEUE STATUS ==========\n\n";
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        cout << "\n========== PORT QUEUE STATUS ==========\n";
+        cout << "Arrivals simulated: " << arrivalsSimulated << "\n\n";
+        for (unsigned int i = 0; i < totalPorts; i++) {
             cout << ports[i].portName << ":\n";
-            cout << "  Docking Capacity: " << DOCKING_SLOTS << " slots\n";
-            cout << "  Currently Occupied: " << ports[i].occupiedSlots << " slots\n";
+            const BerthHeap* docked = ports[i].dockedShips;
+            cout << "  Docking Capacity: " << ports[i].dockingSlots << " slots\n";
+            cout << "  Currently Occupied: " << docked->size() << " slots\n";
             
-            if (ports[i].occupiedSlots > 0) {
+            if (docked->size() > 0) {
                 cout << "  Docked Ships Service Time:\n";
-                for (int j = 0; j < DOCKING_SLOTS; j++) {
-                    if (ports[i].currentDockedShips[j] > 0) {
+                for (unsigned short j = 0; j < docked->size(); j++) {
+                    if (docked->at(j) > 0) {
                         cout << "    Slot " << (j+1) << ": " 
-                             << (ports[i].currentDockedShips[j] / 60) << " hours remaining\n";
+                             << (docked->at(j) / 60) << " hours remaining\n";
                     }
                 }
             }
@@ -994,138 +6360,291 @@ public:
             cout << "\n";
         }
     }
-
-    void run() {
-        loadPortCharges();
-        loadRoutes();
+    
+    // Writes an absolute minute as "DD/MM/YYYY HH:MM"
+    static void formatMinute(unsigned int minute, char* out) {
+        char date[MAX_DATE_LENGTH], time[MAX_TIME_LENGTH];
+        dayNumberToDate((unsigned short)(minute / 1440), date);
+        minutesToTime(minute % 1440, time);
+        snprintf(out, MAX_DATE_LENGTH + MAX_TIME_LENGTH, "%s %s", date, time);
+    }
+    
+    // Replays every live sailing through the docking slots (see
+    // DockingSimulator) and reports the exact waits. The port queues shown
+    // by displayPortQueueStatus are left untouched.
+    void simulateDocking() {
+        cout << "\n========== DOCKING SIMULATION ==========\n";
+        if (!csr.isBuilt() && !csr.build(ports, totalPorts)) {
+            cout << "\n❌ Not enough memory for route search!\n";
+            return;
+        }
         
-        if (totalPorts == 0) {
-            cout << "❌ No ports loaded!\n";
+        SimShip* ships = new (nothrow) SimShip[csr.edgeCount + 1];
+        unsigned int* shipEdge = new (nothrow) unsigned int[csr.edgeCount + 1];
+        unsigned long long* portWait = new (nothrow) unsigned long long[totalPorts + 1];
+        unsigned int* portShips = new (nothrow) unsigned int[totalPorts + 1];
+        unsigned short* berths = new (nothrow) unsigned short[totalPorts + 1];
+        DockingSimulator sim;
+        unsigned int shipCount = 0;
+        bool ok = ships && shipEdge && portWait && portShips && berths;
+        for (unsigned int p = 0; ok && p < totalPorts; p++) {
+            berths[p] = ports[p].dockingSlots;
+        }
+        for (unsigned int e = 0; ok && e < csr.edgeCount; e++) {
+            if (csr.isCancelled(e)) continue;
+            ships[shipCount].port = csr.destination[e];
+            ships[shipCount].arrival = arrivalMinute(csr.voyageDay[e], csr.departureMins[e], 
+                                                     csr.arrivalMins[e]);
+            ships[shipCount].service = calculateServiceTime(csr.voyageCost[e]);
+            shipEdge[shipCount++] = e;
+        }
+        if (!ok || !sim.run(ships, shipCount, berths, totalPorts)) {
+            cout << "\n❌ Not enough memory to simulate docking!\n";
+            delete[] ships;
+            delete[] shipEdge;
+            delete[] portWait;
+            delete[] portShips;
+            delete[] berths;
             return;
         }
+        
+        for (unsigned int p = 0; p < totalPorts; p++) {
+            portWait[p] = 0;
+            portShips[p] = 0;
+        }
+        ofstream out(DOCKING_SIM_FILE);
+        if (out) out << "Origin,Port,Company,Arrived,Docked,Departed,Wait (min),Berth\n";
+        unsigned long long totalWait = 0;
+        unsigned int waited = 0, longest = 0;
+        for (unsigned int s = 0; s < shipCount; s++) {
+            unsigned int wait = sim.dockMinute[s] - ships[s].arrival;
+            unsigned int p = ships[s].port;
+            totalWait += wait;
+            portWait[p] += wait;
+            portShips[p]++;
+            if (wait > 0) waited++;
+            if (wait > sim.dockMinute[longest] - ships[longest].arrival) longest = s;
+            if (!out) continue;
+            
+            char arrived[MAX_DATE_LENGTH + MAX_TIME_LENGTH];
+            char docked[MAX_DATE_LENGTH + MAX_TIME_LENGTH];
+            char departed[MAX_DATE_LENGTH + MAX_TIME_LENGTH];
+            formatMinute(ships[s].arrival, arrived);
+            formatMinute(sim.dockMinute[s], docked);
+            formatMinute(sim.departMinute[s], departed);
+            unsigned int e = shipEdge[s];
+            out << ports[csr.source[e]].portName << "," << ports[p].portName << "," 
+                << companies.name(csr.companyId[e]) << "," << arrived << "," << docked << "," 
+                << departed << "," << wait << "," << (sim.berth[s] + 1) << "\n";
+        }
+        
+        cout << "Replayed " << shipCount << " ship arrivals at " << totalPorts << " ports (" 
+             << sim.eventsProcessed << " events).\n";
+        if (shipCount > 0) {
+            cout << "Ships that waited for a slot: " << waited << " of " << shipCount << "\n";
+            cout << "Average wait: " << (totalWait / shipCount) << " min\n";
+        }
+        if (waited > 0) {
+            unsigned int e = shipEdge[longest];
+            char arrived[MAX_DATE_LENGTH + MAX_TIME_LENGTH];
+            formatMinute(ships[longest].arrival, arrived);
+            cout << "Longest wait: " << (sim.dockMinute[longest] - ships[longest].arrival) 
+                 << " min (" << companies.name(csr.companyId[e]) << " " 
+                 << ports[csr.source[e]].portName << " → " << ports[ships[longest].port].portName 
+                 << ", arriving " << arrived << ")\n";
+            
+            cout << "\nPorts with the most waiting:\n";
+            for (int rank = 0; rank < 5; rank++) {
+                unsigned int best = totalPorts;
+                for (unsigned int p = 0; p < totalPorts; p++) {
+                    if (portWait[p] > 0 && (best == totalPorts || portWait[p] > portWait[best])) {
+                        best = p;
+                    }
+                }
+                if (best == totalPorts) break;
+                cout << "  " << ports[best].portName << ": " << portShips[best] << " ships, avg wait " 
+                     << (portWait[best] / portShips[best]) << " min, queue peak " 
+                     << sim.queuePeak[best] << "\n";
+                portWait[best] = 0;
+            }
+        }
+        if (out) {
+            cout << "\nPer-ship timeline: " << DOCKING_SIM_FILE << "\n";
+        } else {
+            cout << "\n❌ Could not write " << DOCKING_SIM_FILE << "!\n";
+        }
+        
+        delete[] ships;
+        delete[] shipEdge;
+        delete[] portWait;
+        delete[] portShips;
+        delete[] berths;
+    }
 
-        int choice;
-        do {
-            cout << "\n╔════════════════════════════════╗\n";
-            cout << "║   OCEANROUTE NAV - MENU       ║\n";
-            cout << "╚════════════════════════════════╝\n";
-            cout << "1. Display Network\n";
-            cout << "2. Display Port Queue Status\n";
-            cout << "3. Find Cheapest Route\n";
-            cout << "4. Find Route with Preferences\n";
-            cout << "5. Exit\n\n";
-            cout << "Choice (1-5): ";
+    // Loads the network, reusing the last snapshot if neither text file has
+    // changed since. Returns false if no ports were loaded.
+    bool load() {
+        FileStamp chargesStamp = stampFile("PortCharges.txt");
+        FileStamp routesStamp = stampFile("Routes.txt");
+        
+        if (!loadSnapshot(SNAPSHOT_FILE, chargesStamp, routesStamp)) {
+            loadPortCharges();
+            loadRoutes();
+            if (totalPorts > 0 && !saveSnapshot(SNAPSHOT_FILE, chargesStamp, routesStamp)) {
+                *log << "Warning: Could not write " << SNAPSHOT_FILE << "\n";
+            }
+        }
+        return totalPorts > 0;
+    }
+
+    // Runs one menu command against this network (see NetworkHost::run)
+    void runMenuChoice(int choice) {
+        switch (choice) {
+            case 1:
+                displayGraph();
+                break;
             
-            if (!(cin >> choice)) {
-                cout << "❌ Invalid input!\n";
+            case 2:
+                displayPortQueueStatus();
+                break;
+                
+            case 3: {
+                char date[MAX_DATE_LENGTH];
+                int si, di;
+                
+                if (readRouteQuery("Find Cheapest Route", si, di, date)) {
+                    cout << "\n🔍 Using A* with landmark bounds\n";
+                    findCheapestRoute(si, di, date, SEARCH_ASTAR, NULL);
+                }
                 clearInputBuffer();
-                continue;
+                break;
             }
-            clearInputBuffer();
-
-            switch (choice) {
-                case 1:
-                    displayGraph();
-                    break;
+            
+            case 4: {
+                char date[MAX_DATE_LENGTH];
+                int si, di;
                 
-                case 2:
-                    displayPortQueueStatus();
-                    break;
-                    
-                case 3: {
-                    char src[MAX_NAME_LENGTH], dst[MAX_NAME_LENGTH], date[MAX_DATE_LENGTH];
+                bool found = readRouteQuery("Find Route with Custom Preferences", si, di, date);
+                clearInputBuffer();
+                
+                if (found) {
+                    UserPreferences prefs = getUserPreferences();
                     
-                    cout << "\n--- Find Cheapest Route ---\n";
-                    cout << "Ports: ";
-                    for (unsigned char i = 0; i < totalPorts; i++) {
-                        cout << ports[i].portName;
-                        if (i < totalPorts - 1) cout << ", ";
-                    }
-                    cout << "\n\n";
+                    bool hasDirectRoute = hasValidDirectRoute(si, di, date, &prefs);
                     
-                    cout << "Source: ";
-                    cin >> src;
-                    cout << "Destination: ";
-                    cin >> dst;
-                    cout << "Date (DD/MM/YYYY): ";
-                    cin >> date;
-
-                    int si = getPortIndex(src);
-                    int di = getPortIndex(dst);
-
-                    if (si == -1) {
-                        cout << "❌ Source port '" << src << "' not found!\n";
-                    } else if (di == -1) {
-                        cout << "❌ Destination port '" << dst << "' not found!\n";
+                    if (hasDirectRoute && !prefs.hasAnyFilter()) {
+                        cout << "\n🎯 Direct route detected - Using A* algorithm\n";
+                        findCheapestRoute(si, di, date, SEARCH_ASTAR, &prefs);
                     } else {
-                        bool hasDirectRoute = hasValidDirectRoute(si, di, date, NULL);
-                        
-                        if (hasDirectRoute) {
-                            cout << "\n🎯 Direct route detected - Using A* algorithm\n";
-                            findCheapestRoute(si, di, date, true, NULL);
-                        } else {
-                            cout << "\n🔍 Multi-hop route needed - Using Dijkstra's algorithm\n";
-                            findCheapestRoute(si, di, date, false, NULL);
-                        }
+                        cout << "\n🔍 Multi-hop/Filtered route - Using Dijkstra's algorithm\n";
+                        findCheapestRoute(si, di, date, SEARCH_DIJKSTRA, &prefs);
                     }
-                    clearInputBuffer();
-                    break;
                 }
+                break;
+            }
+            
+            case 5: {
+                char date[MAX_DATE_LENGTH];
+                int si, di;
                 
-                case 4: {
-                    char src[MAX_NAME_LENGTH], dst[MAX_NAME_LENGTH], date[MAX_DATE_LENGTH];
+                bool found = readRouteQuery("Find Earliest Arrival (Schedule)", si, di, date);
+                clearInputBuffer();
+                
+                if (found) {
+                    char choice;
+                    cout << "Apply preferences? (y/n): ";
+                    cin >> choice;
+                    clearInputBuffer();
                     
-                    cout << "\n--- Find Route with Custom Preferences ---\n";
-                    cout << "Ports: ";
-                    for (unsigned char i = 0; i < totalPorts; i++) {
-                        cout << ports[i].portName;
-                        if (i < totalPorts - 1) cout << ", ";
+                    if (choice == 'y' || choice == 'Y') {
+                        UserPreferences prefs = getUserPreferences();
+                        findEarliestArrival(si, di, date, &prefs);
+                    } else {
+                        findEarliestArrival(si, di, date, NULL);
                     }
-                    cout << "\n\n";
-                    
-                    cout << "Source: ";
-                    cin >> src;
-                    cout << "Destination: ";
-                    cin >> dst;
-                    cout << "Date (DD/MM/YYYY): ";
-                    cin >> date;
+                }
+                break;
+            }
+            
+            case 6: {
+                char date[MAX_DATE_LENGTH];
+                int si, di;
+                
+                bool found = readRouteQuery("Compare Routes (Cost / Time / Legs)", si, di, date);
+                clearInputBuffer();
+                
+                if (found) {
+                    char choice;
+                    cout << "Apply preferences? (y/n): ";
+                    cin >> choice;
                     clearInputBuffer();
-
-                    int si = getPortIndex(src);
-                    int di = getPortIndex(dst);
-
-                    if (si == -1) {
-                        cout << "❌ Source port '" << src << "' not found!\n";
-                    } else if (di == -1) {
-                        cout << "❌ Destination port '" << dst << "' not found!\n";
-                    } else {
+                    
+                    if (choice == 'y' || choice == 'Y') {
                         UserPreferences prefs = getUserPreferences();
-                        
-                        bool hasDirectRoute = hasValidDirectRoute(si, di, date, &prefs);
-                        
-                        if (hasDirectRoute && !prefs.hasAnyFilter()) {
-                            cout << "\n🎯 Direct route detected - Using A* algorithm\n";
-                            findCheapestRoute(si, di, date, true, &prefs);
-                        } else {
-                            cout << "\n🔍 Multi-hop/Filtered route - Using Dijkstra's algorithm\n";
-                            findCheapestRoute(si, di, date, false, &prefs);
-                        }
+                        findParetoRoutes(si, di, date, &prefs);
+                    } else {
+                        findParetoRoutes(si, di, date, NULL);
                     }
-                    break;
                 }
+                break;
+            }
+            
+            case 7:
+                buildContractionHierarchy();
+                break;
+            
+            case 8: {
+                char date[MAX_DATE_LENGTH];
+                int si, di;
                 
-                case 5:
-                    cout << "\nThank you! Safe travels! 🚢\n";
-                    break;
+                bool found = readRouteQuery("Find Cheapest Route (Bidirectional Dijkstra)", si, di, date);
+                clearInputBuffer();
+                
+                if (found) {
+                    char choice;
+                    cout << "Apply preferences? (y/n): ";
+                    cin >> choice;
+                    clearInputBuffer();
                     
-                default:
-                    cout << "❌ Invalid choice!\n";
+                    if (choice == 'y' || choice == 'Y') {
+                        UserPreferences prefs = getUserPreferences();
+                        findCheapestRoute(si, di, date, SEARCH_BIDIRECTIONAL, &prefs);
+                    } else {
+                        findCheapestRoute(si, di, date, SEARCH_BIDIRECTIONAL, NULL);
+                    }
+                }
+                break;
             }
-        } while (choice != 5);
+            
+            case 9:
+                exportCostMatrix();
+                clearInputBuffer();
+                break;
+            
+            case 10:
+                quoteBatchFromFile();
+                break;
+            
+            case 12:
+                applyRouteUpdatesFromFile();
+                break;
+            
+            case 13:
+                simulateDocking();
+                break;
+            
+            case 14:
+                verifySearchEngines();
+                verifyNetworkLoading();
+                break;
+                
+            default:
+                cout << "❌ Invalid choice!\n";
+        }
     }
 
     ~Graph() {
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        for (unsigned int i = 0; i < totalPorts; i++) {
             RouteNode* curr = ports[i].routeListHead;
             while (curr) {
                 RouteNode* temp = curr;
@@ -1133,13 +6652,220 @@ public:
                 delete temp;
             }
             delete ports[i].waitingQueue;
+            delete ports[i].dockedShips;
+            delete ports[i].berthsFree;
+        }
+        delete[] ports;
+    }
+};
+
+// ---------------- HOT RELOAD ----------------
+// Every menu command runs against the live Graph version. A reload builds a
+// complete new Graph from the text files on a background thread and
+// publishes it with one atomic pointer swap, so a command that started on
+// the old version finishes there while new commands see the new one.
+// Swapped-out versions are freed once their last reader has released them.
+
+struct GraphVersion {
+    Graph* graph;
+    unsigned int number;         // 1 for the network loaded at startup
+    atomic<int> readers;         // commands still running on this version
+    GraphVersion* nextRetired;
+    
+    GraphVersion(Graph* g, unsigned int n) : graph(g), number(n), readers(0), nextRetired(NULL) {}
+};
+
+class NetworkHost {
+private:
+    atomic<GraphVersion*> live;
+    atomic<int> entering;        // readers between loading live and pinning it
+    mutex retiredLock;           // publisher and reclaimer only, never readers
+    GraphVersion* retired;       // swapped out, waiting for readers to drain
+    
+    thread reloader;
+    atomic<bool> reloadRunning;
+    atomic<bool> reloadDone;     // set once reloadLog and reloadVersion are final
+    ostringstream reloadLog;
+    unsigned int reloadVersion;  // version published by the reload, 0 if none
+    
+    // Swaps graph in as the live version; the old one retires
+    unsigned int publish(Graph* graph) {
+        GraphVersion* fresh = new (nothrow) GraphVersion(graph, live.load()->number + 1);
+        if (!fresh) {
+            delete graph;
+            return 0;
+        }
+        GraphVersion* old = live.exchange(fresh);
+        
+        lock_guard<mutex> hold(retiredLock);
+        old->nextRetired = retired;
+        retired = old;
+        return fresh->number;
+    }
+    
+    // Frees retired versions nobody is reading. A reader that loaded live
+    // before the swap is either counted in entering or already pinned.
+    void reclaim() {
+        if (entering.load() != 0) return;
+        
+        lock_guard<mutex> hold(retiredLock);
+        GraphVersion** link = &retired;
+        while (*link) {
+            GraphVersion* version = *link;
+            if (version->readers.load() == 0) {
+                *link = version->nextRetired;
+                delete version->graph;
+                delete version;
+            } else {
+                link = &version->nextRetired;
+            }
+        }
+    }
+    
+    void reloadInBackground() {
+        Graph* fresh = new (nothrow) Graph();
+        reloadVersion = 0;
+        if (!fresh) {
+            reloadLog << "Error: Not enough memory to reload the network\n";
+        } else {
+            fresh->setLog(reloadLog);
+            if (fresh->load()) {
+                fresh->setLog(cout);
+                reloadVersion = publish(fresh);
+            } else {
+                delete fresh;
+            }
+        }
+        reloadDone.store(true);
+        reloadRunning.store(false);
+    }
+    
+    void startReload() {
+        reportReload();
+        if (reloadRunning.load()) {
+            cout << "\n⏳ A reload is already running.\n";
+            return;
+        }
+        if (reloader.joinable()) reloader.join();
+        
+        reloadLog.str("");
+        reloadDone.store(false);
+        reloadRunning.store(true);
+        reloader = thread(&NetworkHost::reloadInBackground, this);
+        cout << "\n🔄 Reloading PortCharges.txt and Routes.txt in the background.\n";
+        cout << "   Queries keep using network version " << live.load()->number 
+             << " until it finishes.\n";
+    }
+    
+    // Reports a finished reload once, between commands
+    void reportReload() {
+        if (!reloadDone.exchange(false)) return;
+        reloader.join();
+        
+        cout << "\n========== RELOAD FINISHED ==========\n" << reloadLog.str();
+        if (reloadVersion != 0) {
+            cout << "✅ Now serving network version " << reloadVersion << "\n";
+        } else {
+            cout << "❌ Reload failed - still serving network version " 
+                 << live.load()->number << "\n";
+        }
+        cout << "=====================================\n";
+    }
+
+public:
+    NetworkHost() : live(NULL), entering(0), retired(NULL), reloadRunning(false), 
+                    reloadDone(false), reloadVersion(0) {}
+    
+    // Pins the live version for one command; pair with release
+    GraphVersion* acquire() {
+        entering++;
+        GraphVersion* version = live.load();
+        version->readers++;
+        entering--;
+        return version;
+    }
+    
+    void release(GraphVersion* version) {
+        version->readers--;
+    }
+    
+    void run() {
+        Graph* first = new (nothrow) Graph();
+        if (!first || !first->load()) {
+            delete first;
+            cout << "❌ No ports loaded!\n";
+            return;
+        }
+        GraphVersion* initial = new (nothrow) GraphVersion(first, 1);
+        if (!initial) {
+            delete first;
+            cout << "❌ Not enough memory to start!\n";
+            return;
+        }
+        live.store(initial);
+        
+        int choice;
+        do {
+            reportReload();
+            reclaim();
+            
+            cout << "\n╔════════════════════════════════╗\n";
+            cout << "║   OCEANROUTE NAV - MENU       ║\n";
+            cout << "╚════════════════════════════════╝\n";
+            cout << "1. Display Network\n";
+            cout << "2. Display Port Queue Status\n";
+            cout << "3. Find Cheapest Route\n";
+            cout << "4. Find Route with Preferences\n";
+            cout << "5. Find Earliest Arrival (Schedule)\n";
+            cout << "6. Compare Routes (Cost / Time / Legs)\n";
+            cout << "7. Build Fast Query Index (Contraction Hierarchy)\n";
+            cout << "8. Find Cheapest Route (Bidirectional Dijkstra)\n";
+            cout << "9. Export Cost/Time Matrix (All Pairs)\n";
+            cout << "10. Batch Quotes from " << QUOTE_REQUEST_FILE << "\n";
+            cout << "11. Reload Schedule (Background)\n";
+            cout << "12. Apply Route Updates from " << ROUTE_UPDATE_FILE << "\n";
+            cout << "13. Simulate Docking Timeline\n";
+            cout << "14. Self-Check (Search Engines, Loader, Snapshot)\n";
+            cout << "15. Exit\n\n";
+            cout << "Choice (1-15): ";
+            
+            if (!(cin >> choice)) {
+                cout << "❌ Invalid input!\n";
+                clearInputBuffer();
+                continue;
+            }
+            clearInputBuffer();
+            
+            if (choice == 11) {
+                startReload();
+                continue;
+            }
+            
+            GraphVersion* version = acquire();
+            if (choice == 15) {
+                version->graph->displayRouteCacheStats();
+                cout << "\nThank you! Safe travels! 🚢\n";
+            } else {
+                version->graph->runMenuChoice(choice);
+            }
+            release(version);
+        } while (choice != 15);
+    }
+    
+    ~NetworkHost() {
+        if (reloader.joinable()) reloader.join();
+        reclaim();
+        GraphVersion* version = live.load();
+        if (version) {
+            delete version->graph;
+            delete version;
         }
     }
 };
 
 // ---------------- MAIN ----------------
 int main() {
-    Graph network;
-    network.run();
+    NetworkHost host;
+    host.run();
     return 0;
 }
\ No newline at end of file
@@ -3,14 +3,18 @@
 #include <cstring>
 #include <climits>
 #include <cctype>
+#include <cerrno>
+#include <cstdlib>
 using namespace std;
 
-#define MAX_PORTS 15
+#define INITIAL_PORT_CAPACITY 16
 #define MAX_NAME_LENGTH 30
 #define MAX_DATE_LENGTH 11
 #define MAX_TIME_LENGTH 6
 #define MAX_COMPANY_LENGTH 15
 #define MAX_SAVED_JOURNEYS 10
+#define MAX_JOURNEY_NAME_LENGTH (2 * MAX_NAME_LENGTH + 4)   // "<port> to <port>"
+#define DEFAULT_DOCKING_SLOTS 2  // berths at ports PortCharges.txt gives no count for
 
 // ---------------- JOURNEY LEG STRUCTURES (MULTI-LEG ROUTE) ----------------
 
@@ -53,7 +57,7 @@ private:
     int legCount;
     unsigned int totalCost;
     unsigned int totalTime;
-    char journeyName[50];
+    char journeyName[MAX_JOURNEY_NAME_LENGTH];
     
 public:
     Journey() : head(NULL), tail(NULL), legCount(0), totalCost(0), totalTime(0) {
@@ -65,7 +69,8 @@ public:
     }
     
     void setName(const char* name) {
-        strcpy(journeyName, name);
+        strncpy(journeyName, name, MAX_JOURNEY_NAME_LENGTH - 1);
+        journeyName[MAX_JOURNEY_NAME_LENGTH - 1] = '\0';
     }
     
     const char* getName() const {
@@ -252,8 +257,8 @@ private:
     int availableSlots;  // FIX Q1: Port capacity
     
 public:
-    // FIX Q1: Add capacity parameter (default 2 slots per port)
-    DockingQueue(int slots = 2) : front(NULL), rear(NULL), queueSize(0), availableSlots(slots) {}
+    // FIX Q1: Add capacity parameter (the port's berths, see loadPortCharges)
+    DockingQueue(int slots = DEFAULT_DOCKING_SLOTS) : front(NULL), rear(NULL), queueSize(0), availableSlots(slots) {}
     
     ~DockingQueue() {
         while (front) {
@@ -264,7 +269,7 @@ public:
     }
     
     // FIX Q1: Respect capacity when calculating docking time
-    unsigned short calculateDockingTime(unsigned short arrivalTime) {
+    unsigned short calculateDockingTime(unsigned short arrivalTime) const {
         // If fewer ships than slots, dock immediately
         if (queueSize < availableSlots) {
             return arrivalTime;
@@ -292,7 +297,7 @@ public:
         }
     }
     
-    int calculateWaitTime(unsigned short arrivalTime) {
+    int calculateWaitTime(unsigned short arrivalTime) const {
         unsigned short actualDockTime = calculateDockingTime(arrivalTime);
         
         if (actualDockTime < arrivalTime) {
@@ -341,6 +346,12 @@ public:
         }
     }
     
+    // Empty queue for a port with the given number of berths
+    void reset(int slots) {
+        clearQueue();
+        availableSlots = slots;
+    }
+    
     bool isEmpty() const { return queueSize == 0; }
     int getSize() const { return queueSize; }
     int getAvailableSlots() const { return availableSlots; }
@@ -377,7 +388,7 @@ struct UserPreferences {
 // ---------------- ROUTE NODE ----------------
 
 struct RouteNode {
-    unsigned char destinationIndex;
+    unsigned int destinationIndex;
     char voyageDate[MAX_DATE_LENGTH];
     char departureTime[MAX_TIME_LENGTH];
     char arrivalTime[MAX_TIME_LENGTH];
@@ -396,13 +407,15 @@ struct Port {
     RouteNode* routeListHead;
     RouteNode* routeListTail;
     DockingQueue* dockQueue;
+    unsigned short dockingSlots;
     
     Port() {
         portName[0] = '\0';
         dailyDockingCharge = 0;
         routeListHead = NULL;
         routeListTail = NULL;
-        dockQueue = new DockingQueue(2);  // FIX Q1: 2 docking slots per port
+        dockingSlots = DEFAULT_DOCKING_SLOTS;
+        dockQueue = new DockingQueue(dockingSlots);
     }
     
     ~Port() {
@@ -412,73 +425,146 @@ struct Port {
 
 // ---------------- PRIORITY QUEUE ----------------
 
+// Priority Queue Node (one heap slot)
 struct PQNode {
-    unsigned char portIndex;
+    unsigned int portIndex;
     unsigned int cost;
     unsigned int heuristic;
-    PQNode* next;
 };
 
+// Indexed d-ary min-heap keyed by port. Each port sits in the heap at most
+// once, so an improved cost is a decrease-key instead of a duplicate entry.
+#define PQ_ARITY 4
+
 class PriorityQueue {
 private:
-    PQNode* head;
+    PQNode* heap;
+    int* position;      // heap slot of each port, -1 when not queued
+    unsigned int capacity;
     int size;
 
+    static unsigned int priorityOf(const PQNode& node) {
+        return (node.heuristic > 0) ? node.heuristic : node.cost;
+    }
+
+    void place(int slot, const PQNode& node) {
+        heap[slot] = node;
+        position[node.portIndex] = slot;
+    }
+
+    void siftUp(int slot) {
+        PQNode node = heap[slot];
+        unsigned int priority = priorityOf(node);
+        while (slot > 0) {
+            int parent = (slot - 1) / PQ_ARITY;
+            if (priorityOf(heap[parent]) <= priority) break;
+            place(slot, heap[parent]);
+            slot = parent;
+        }
+        place(slot, node);
+    }
+
+    void siftDown(int slot) {
+        PQNode node = heap[slot];
+        unsigned int priority = priorityOf(node);
+        while (true) {
+            int first = slot * PQ_ARITY + 1;
+            if (first >= size) break;
+            int last = first + PQ_ARITY;
+            if (last > size) last = size;
+
+            int best = first;
+            unsigned int bestPriority = priorityOf(heap[first]);
+            for (int c = first + 1; c < last; c++) {
+                unsigned int p = priorityOf(heap[c]);
+                if (p < bestPriority) {
+                    best = c;
+                    bestPriority = p;
+                }
+            }
+            if (bestPriority >= priority) break;
+            place(slot, heap[best]);
+            slot = best;
+        }
+        place(slot, node);
+    }
+
 public:
-    PriorityQueue() : head(NULL), size(0) {}
+    PriorityQueue(unsigned int portCount) : heap(NULL), position(NULL), capacity(0), size(0) {
+        if (portCount == 0) return;
+        heap = new (nothrow) PQNode[portCount];
+        position = new (nothrow) int[portCount];
+        if (!heap || !position) {
+            delete[] heap;
+            delete[] position;
+            heap = NULL;
+            position = NULL;
+            return;
+        }
+        capacity = portCount;
+        for (unsigned int i = 0; i < capacity; i++) {
+            position[i] = -1;
+        }
+    }
     
     ~PriorityQueue() {
-        while (head) {
-            PQNode* temp = head;
-            head = head->next;
-            delete temp;
+        delete[] heap;
+        delete[] position;
+    }
+    
+    // Inserts the port, or lowers its key if it is already queued
+    void push(unsigned int portIdx, unsigned int cost, unsigned int heuristic = 0) {
+        if (portIdx >= capacity) return;
+        
+        PQNode node;
+        node.portIndex = portIdx;
+        node.cost = cost;
+        node.heuristic = heuristic;
+        
+        int slot = position[portIdx];
+        if (slot == -1) {
+            slot = size++;
+            place(slot, node);
+            siftUp(slot);
+        } else if (priorityOf(node) <= priorityOf(heap[slot])) {
+            place(slot, node);
+            siftUp(slot);
         }
     }
     
-    void push(unsigned char portIdx, unsigned int cost, unsigned int heuristic = 0) {
-        PQNode* newNode = new (nothrow) PQNode();
-        if (!newNode) return;
-        
-        newNode->portIndex = portIdx;
-        newNode->cost = cost;
-        newNode->heuristic = heuristic;
-        newNode->next = NULL;
-        size++;
+    bool pop(unsigned int& portIdx, unsigned int& cost, unsigned int& heuristic) {
+        if (size == 0) return false;
         
-        unsigned int priority = (heuristic > 0) ? heuristic : cost;
+        portIdx = heap[0].portIndex;
+        cost = heap[0].cost;
+        heuristic = heap[0].heuristic;
+        position[portIdx] = -1;
         
-        if (!head || priority < (head->heuristic > 0 ? head->heuristic : head->cost)) {
-            newNode->next = head;
-            head = newNode;
-            return;
-        }
-        
-        PQNode* curr = head;
-        while (curr->next) {
-            unsigned int nextPriority = (curr->next->heuristic > 0) ? 
-                                        curr->next->heuristic : curr->next->cost;
-            if (priority < nextPriority) break;
-            curr = curr->next;
+        size--;
+        if (size > 0) {
+            place(0, heap[size]);
+            siftDown(0);
         }
-        newNode->next = curr->next;
-        curr->next = newNode;
+        return true;
     }
     
-    bool pop(unsigned char& portIdx, unsigned int& cost, unsigned int& heuristic) {
-        if (!head) return false;
-        
-        PQNode* temp = head;
-        portIdx = head->portIndex;
-        cost = head->cost;
-        heuristic = head->heuristic;
-        head = head->next;
-        delete temp;
-        size--;
-        return true;
+    bool contains(unsigned int portIdx) const {
+        return portIdx < capacity && position[portIdx] != -1;
     }
     
-    bool isEmpty() const { return head == NULL; }
+    // Empties the queue in O(size) so its storage can serve another search
+    void clear() {
+        for (int i = 0; i < size; i++) {
+            position[heap[i].portIndex] = -1;
+        }
+        size = 0;
+    }
+    
+    bool isEmpty() const { return size == 0; }
     int getSize() const { return size; }
+    
+    // False if the constructor could not allocate the heap
+    bool isValid() const { return heap != NULL; }
 };
 
 // ---------------- HELPER FUNCTIONS ----------------
@@ -539,15 +625,128 @@ void clearInputBuffer() {
     cin.ignore(INT_MAX, '\n');
 }
 
+// Whole-field integer: false for empty text, signs only, stray characters
+// or values outside int
+bool parseIntText(const char* text, int& value) {
+    char* end;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    value = (int)parsed;
+    return true;
+}
+
+void reportBadRow(const char* fileName, int line, const char* message, const char* field) {
+    cout << fileName << ":" << line << ": " << message << " '" << field << "' - row skipped\n";
+}
+
+// ---------------- SEARCH SCRATCH ----------------
+
+// Per-search scratch arrays, sized to the number of loaded ports. The dock
+// queues simulate connections for this search only, so searches never
+// touch the ports' own queues and can run side by side.
+struct SearchScratch {
+    unsigned int* minCost;
+    unsigned int* totalTime;
+    unsigned int* queueWaitTime;
+    unsigned int* layoverTime;
+    unsigned int* dockingCharges;
+    bool* visited;
+    int* prevPort;
+    RouteNode** usedRoute;
+    unsigned int* path;
+    RouteNode** pathRoutes;
+    DockingQueue** dockQueues;
+    unsigned int queueCount;
+    PriorityQueue queue;
+    
+    SearchScratch(unsigned int portCount) : queueCount(0), queue(portCount) {
+        minCost = new (nothrow) unsigned int[portCount];
+        totalTime = new (nothrow) unsigned int[portCount];
+        queueWaitTime = new (nothrow) unsigned int[portCount];
+        layoverTime = new (nothrow) unsigned int[portCount];
+        dockingCharges = new (nothrow) unsigned int[portCount];
+        visited = new (nothrow) bool[portCount];
+        prevPort = new (nothrow) int[portCount];
+        usedRoute = new (nothrow) RouteNode*[portCount];
+        path = new (nothrow) unsigned int[portCount];
+        pathRoutes = new (nothrow) RouteNode*[portCount];
+        dockQueues = new (nothrow) DockingQueue*[portCount];
+        if (dockQueues) {
+            while (queueCount < portCount) {
+                dockQueues[queueCount] = new (nothrow) DockingQueue();
+                if (!dockQueues[queueCount]) break;
+                queueCount++;
+            }
+        }
+    }
+    
+    ~SearchScratch() {
+        delete[] minCost;
+        delete[] totalTime;
+        delete[] queueWaitTime;
+        delete[] layoverTime;
+        delete[] dockingCharges;
+        delete[] visited;
+        delete[] prevPort;
+        delete[] usedRoute;
+        delete[] path;
+        delete[] pathRoutes;
+        for (unsigned int i = 0; i < queueCount; i++) {
+            delete dockQueues[i];
+        }
+        delete[] dockQueues;
+    }
+    
+    bool isValid(unsigned int portCount) const {
+        return minCost && totalTime && queueWaitTime && layoverTime && dockingCharges &&
+               visited && prevPort && usedRoute && path && pathRoutes && 
+               dockQueues && queueCount == portCount && queue.isValid();
+    }
+};
+
+// Outcome of Graph::queryCheapestRoute
+#define QUERY_FOUND 0
+#define QUERY_NO_ROUTE 1
+#define QUERY_INVALID_PORT 2
+#define QUERY_INVALID_DATE 3
+#define QUERY_SAME_PORT 4
+#define QUERY_AVOIDS_ENDPOINT 5     // avoided port is the source or destination
+#define QUERY_NO_MEMORY 6
+
+// A cheapest route as plain data. path, legs and dockQueues point into the
+// caller's SearchScratch: path[0] is the source, and legs[i] sails
+// path[i] -> path[i + 1].
+struct RouteResult {
+    int status;                     // QUERY_* code
+    bool usedAStar;
+    const unsigned int* path;
+    RouteNode* const* legs;
+    DockingQueue* const* dockQueues;    // this search's simulated port queues
+    unsigned int portCount;         // ports on the path, legs is one shorter
+    unsigned int cost;              // voyage cost plus docking charges
+    unsigned int hours;
+    unsigned int queueWaitHours;
+    unsigned int nodesExplored;
+    unsigned int routesFiltered;
+    
+    RouteResult() : status(QUERY_NO_ROUTE), usedAStar(false), path(NULL), legs(NULL), 
+                    dockQueues(NULL), portCount(0),
+                    cost(0), hours(0), queueWaitHours(0), nodesExplored(0), routesFiltered(0) {}
+};
+
 // ---------------- GRAPH CLASS ----------------
 class Graph {
 private:
-    Port ports[MAX_PORTS];
-    unsigned char totalPorts;
+    Port* ports;                 // growable port registry
+    unsigned int totalPorts;
+    unsigned int portCapacity;
     Journey* savedJourneys[MAX_SAVED_JOURNEYS];
     int journeyCount;
     
-    unsigned int calculateHeuristic(unsigned char fromPort, unsigned char toPort) const {
+    unsigned int calculateHeuristic(unsigned int fromPort, unsigned int toPort) const {
         if (fromPort == toPort) return 0;
         
         RouteNode* route = ports[fromPort].routeListHead;
@@ -569,7 +768,7 @@ private:
         return 5000;
     }
     
-    bool matchesPreferences(const RouteNode* route, unsigned char portIndex, 
+    bool matchesPreferences(const RouteNode* route, unsigned int portIndex, 
                            const UserPreferences& prefs) const {
         if (!route) return false;
         
@@ -617,7 +816,7 @@ private:
         RouteNode* route = ports[srcIdx].routeListHead;
         
         while (route) {
-            if (route->destinationIndex == destIdx) {
+            if (route->destinationIndex == (unsigned int)destIdx) {
                 if (isSameDateOrLater(route->voyageDate, date)) {
                     if (prefs) {
                         if (!matchesPreferences(route, destIdx, *prefs)) {
@@ -633,9 +832,34 @@ private:
         
         return false;
     }
+    
+    // Grow the port registry so it can hold at least 'needed' ports.
+    // Each Port owns its DockingQueue, so queues are swapped across
+    // rather than copied.
+    bool ensurePortCapacity(unsigned int needed) {
+        if (needed <= portCapacity) return true;
+        
+        unsigned int newCapacity = portCapacity ? portCapacity : INITIAL_PORT_CAPACITY;
+        while (newCapacity < needed) {
+            newCapacity *= 2;
+        }
+        
+        Port* grown = new (nothrow) Port[newCapacity];
+        if (!grown) return false;
+        
+        for (unsigned int i = 0; i < totalPorts; i++) {
+            DockingQueue* spare = grown[i].dockQueue;
+            grown[i] = ports[i];
+            ports[i].dockQueue = spare;
+        }
+        delete[] ports;
+        ports = grown;
+        portCapacity = newCapacity;
+        return true;
+    }
 
 public:
-    Graph() : totalPorts(0), journeyCount(0) {
+    Graph() : ports(NULL), totalPorts(0), portCapacity(0), journeyCount(0) {
         for (int i = 0; i < MAX_SAVED_JOURNEYS; i++) {
             savedJourneys[i] = NULL;
         }
@@ -643,7 +867,7 @@ public:
 
     int getPortIndex(const char* portName) const {
         if (!portName) return -1;
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        for (unsigned int i = 0; i < totalPorts; i++) {
             if (strcmp(ports[i].portName, portName) == 0)
                 return i;
         }
@@ -651,7 +875,7 @@ public:
     }
 
     inline bool isValidPortIndex(int index) const {
-        return (index >= 0 && index < totalPorts);
+        return (index >= 0 && (unsigned int)index < totalPorts);
     }
 
     void loadPortCharges() {
@@ -661,21 +885,60 @@ public:
             return;
         }
 
-        char name[MAX_NAME_LENGTH];
-        int charge;
-        
-        while (file >> name >> charge && totalPorts < MAX_PORTS) {
+        // One port per line: name, daily charge and an optional berth count
+        char line[256];
+        int lineNumber = 0;
+        while (file.getline(line, sizeof(line)) || !file.eof()) {
+            lineNumber++;
+            if (file.fail()) {
+                file.clear();
+                file.ignore(INT_MAX, '\n');
+                reportBadRow("PortCharges.txt", lineNumber, "line too long", "...");
+                continue;
+            }
+            
+            char* fields[4];
+            int count = 0;
+            for (char* field = strtok(line, " \t\r"); field && count < 4; field = strtok(NULL, " \t\r")) {
+                fields[count++] = field;
+            }
+            if (count == 0) continue;
+            if (count < 2) {
+                reportBadRow("PortCharges.txt", lineNumber, "missing docking charge after", fields[0]);
+                continue;
+            }
+            if (count > 3) {
+                reportBadRow("PortCharges.txt", lineNumber, "unexpected extra field", fields[3]);
+                continue;
+            }
+            
+            int charge, berths = DEFAULT_DOCKING_SLOTS;
+            if (strlen(fields[0]) >= MAX_NAME_LENGTH) {
+                reportBadRow("PortCharges.txt", lineNumber, "port name too long", fields[0]);
+                continue;
+            }
+            if (!parseIntText(fields[1], charge)) {
+                reportBadRow("PortCharges.txt", lineNumber, "invalid docking charge", fields[1]);
+                continue;
+            }
+            if (count == 3 && (!parseIntText(fields[2], berths) || berths < 1 || berths > USHRT_MAX)) {
+                reportBadRow("PortCharges.txt", lineNumber, "invalid berth count", fields[2]);
+                continue;
+            }
             if (charge < 0) continue;
+            if (!ensurePortCapacity(totalPorts + 1)) break;
             
-            strcpy(ports[totalPorts].portName, name);
+            strcpy(ports[totalPorts].portName, fields[0]);
             ports[totalPorts].dailyDockingCharge = (unsigned short)charge;
             ports[totalPorts].routeListHead = NULL;
             ports[totalPorts].routeListTail = NULL;
+            ports[totalPorts].dockingSlots = (unsigned short)berths;
+            ports[totalPorts].dockQueue->reset(berths);
             totalPorts++;
         }
 
         file.close();
-        cout << "Loaded " << (int)totalPorts << " ports.\n";
+        cout << "Loaded " << totalPorts << " ports.\n";
     }
 
     void loadRoutes() {
@@ -699,7 +962,7 @@ public:
             RouteNode* node = new (nothrow) RouteNode();
             if (!node) break;
 
-            node->destinationIndex = (unsigned char)toIdx;
+            node->destinationIndex = (unsigned int)toIdx;
             strcpy(node->voyageDate, date);
             strcpy(node->departureTime, depTime);
             strcpy(node->arrivalTime, arrTime);
@@ -730,7 +993,7 @@ public:
         }
         
         cout << "\n========== PORT NETWORK ==========\n\n";
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        for (unsigned int i = 0; i < totalPorts; i++) {
             cout << ports[i].portName << " ($" << ports[i].dailyDockingCharge << "/day)";
             
             // FIX Q4: Show ship count for each port
@@ -756,57 +1019,69 @@ public:
         }
     }
 
-    Journey* findCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, 
-                          bool useAStar = false, const UserPreferences* prefs = NULL,
-                          bool saveJourney = false) {
+    // Cheapest route from srcIdx to destIdx over routes sailing on or after
+    // preferredDate. Prints nothing and allocates nothing beyond scratch;
+    // result.path and result.legs point into scratch. Connection waits come
+    // from scratch's own dock queues, so the graph is only read and any
+    // number of threads may query it at once, each with its own scratch.
+    void queryCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, bool useAStar,
+                            const UserPreferences* prefs, SearchScratch& scratch,
+                            RouteResult& result) const {
+        result = RouteResult();
+        result.usedAStar = useAStar;
+        
         if (!isValidPortIndex(srcIdx) || !isValidPortIndex(destIdx)) {
-            cout << "\n❌ Invalid port indices!\n";
-            return NULL;
+            result.status = QUERY_INVALID_PORT;
+            return;
         }
-        
         if (!isValidDateFormat(preferredDate)) {
-            cout << "\n❌ Invalid date format!\n";
-            return NULL;
+            result.status = QUERY_INVALID_DATE;
+            return;
         }
-        
         if (srcIdx == destIdx) {
-            cout << "\n❌ Source and destination are the same!\n";
-            return NULL;
+            result.status = QUERY_SAME_PORT;
+            return;
         }
-        
         if (prefs && prefs->hasAvoidPort) {
             if (strcmp(ports[srcIdx].portName, prefs->avoidPort) == 0 ||
                 strcmp(ports[destIdx].portName, prefs->avoidPort) == 0) {
-                cout << "\n❌ Cannot avoid source or destination port!\n";
-                return NULL;
+                result.status = QUERY_AVOIDS_ENDPOINT;
+                return;
             }
         }
-
-        for (unsigned char i = 0; i < totalPorts; i++) {
-            ports[i].dockQueue->clearQueue();
+        if (!scratch.isValid(totalPorts)) {
+            result.status = QUERY_NO_MEMORY;
+            return;
         }
 
-        const char* algoName = useAStar ? "A* ALGORITHM" : "DIJKSTRA'S ALGORITHM";
+        DockingQueue* const* dockQueues = scratch.dockQueues;
+        for (unsigned int i = 0; i < totalPorts; i++) {
+            dockQueues[i]->reset(ports[i].dockingSlots);
+        }
         
-        unsigned int minCost[MAX_PORTS];
-        unsigned int totalTime[MAX_PORTS];
-        unsigned int queueWaitTime[MAX_PORTS] = {0};
-        unsigned int layoverTime[MAX_PORTS] = {0};
-        unsigned int dockingCharges[MAX_PORTS] = {0};
-        bool visited[MAX_PORTS] = {false};
-        char prevPort[MAX_PORTS];
-        RouteNode* usedRoute[MAX_PORTS] = {NULL};
-        unsigned int nodesExplored = 0;
-        unsigned int routesFiltered = 0;
+        unsigned int* minCost = scratch.minCost;
+        unsigned int* totalTime = scratch.totalTime;
+        unsigned int* queueWaitTime = scratch.queueWaitTime;
+        unsigned int* layoverTime = scratch.layoverTime;
+        unsigned int* dockingCharges = scratch.dockingCharges;
+        bool* visited = scratch.visited;
+        int* prevPort = scratch.prevPort;
+        RouteNode** usedRoute = scratch.usedRoute;
 
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        for (unsigned int i = 0; i < totalPorts; i++) {
             minCost[i] = UINT_MAX;
             totalTime[i] = 0;
+            queueWaitTime[i] = 0;
+            layoverTime[i] = 0;
+            dockingCharges[i] = 0;
+            visited[i] = false;
             prevPort[i] = -1;
+            usedRoute[i] = NULL;
         }
         minCost[srcIdx] = 0;
 
-        PriorityQueue pq;
+        PriorityQueue& pq = scratch.queue;
+        pq.clear();
         
         if (useAStar) {
             unsigned int h = calculateHeuristic(srcIdx, destIdx);
@@ -816,26 +1091,26 @@ public:
         }
 
         while (!pq.isEmpty()) {
-            unsigned char currPort;
+            unsigned int currPort;
             unsigned int currCost, currHeuristic;
             
             if (!pq.pop(currPort, currCost, currHeuristic)) break;
             
             if (visited[currPort]) continue;
             visited[currPort] = true;
-            nodesExplored++;
+            result.nodesExplored++;
 
-            if (currPort == destIdx) break;
+            if (currPort == (unsigned int)destIdx) break;
 
             RouteNode* route = ports[currPort].routeListHead;
             while (route) {
-                unsigned char nextPort = route->destinationIndex;
+                unsigned int nextPort = route->destinationIndex;
                 
                 bool passesFilter = true;
                 if (prefs) {
                     passesFilter = matchesPreferences(route, nextPort, *prefs);
                     if (!passesFilter) {
-                        routesFiltered++;
+                        result.routesFiltered++;
                     }
                 }
                 
@@ -852,7 +1127,7 @@ public:
                         );
                         
                         if (timeValid) {
-                            int queueWait = ports[currPort].dockQueue->calculateWaitTime(
+                            int queueWait = dockQueues[currPort]->calculateWaitTime(
                                 usedRoute[currPort]->arrivalMins
                             );
                             additionalWait = queueWait / 60;
@@ -893,7 +1168,7 @@ public:
                             if (prevPort[currPort] != -1) {
                                 // FIX Q3: Keep service time fixed at 120 minutes (2 hours)
                                 // Reason: We don't have cargo/capacity data in Routes.txt
-                                ports[currPort].dockQueue->enqueue(
+                                dockQueues[currPort]->enqueue(
                                     usedRoute[currPort]->shippingCompany,
                                     usedRoute[currPort]->arrivalMins,
                                     120  // Fixed service time
@@ -914,28 +1189,80 @@ public:
         }
 
         if (minCost[destIdx] == UINT_MAX) {
-            cout << "\n❌ No route found from " << ports[srcIdx].portName 
-                 << " to " << ports[destIdx].portName;
-            if (prefs && prefs->hasAnyFilter()) {
-                cout << " matching your preferences";
-            }
-            cout << "\n";
-            if (routesFiltered > 0) {
-                cout << "(" << routesFiltered << " routes filtered out by preferences)\n";
-            }
-            return NULL;
+            result.status = QUERY_NO_ROUTE;
+            return;
         }
 
-        unsigned char path[MAX_PORTS];
-        RouteNode* routes[MAX_PORTS];
-        unsigned char len = 0;
+        // Walk back from the destination, then flip to source-first order
+        unsigned int* path = scratch.path;
+        RouteNode** legs = scratch.pathRoutes;
+        unsigned int len = 0;
         
-        for (char curr = destIdx; curr != -1 && len < MAX_PORTS; curr = prevPort[curr]) {
+        for (int curr = destIdx; curr != -1 && len < totalPorts; curr = prevPort[curr]) {
             path[len] = curr;
-            routes[len] = usedRoute[curr];
+            legs[len] = usedRoute[curr];
             len++;
         }
+        for (unsigned int i = 0, j = len - 1; i < j; i++, j--) {
+            unsigned int port = path[i];
+            path[i] = path[j];
+            path[j] = port;
+        }
+        // legs[k] arrived at the port now at path[len - 1 - k], so the leg
+        // leaving path[i] is legs[len - 2 - i]; reverse the first len - 1
+        for (unsigned int i = 0, j = len - 2; len > 1 && i < j; i++, j--) {
+            RouteNode* leg = legs[i];
+            legs[i] = legs[j];
+            legs[j] = leg;
+        }
+        
+        result.status = QUERY_FOUND;
+        result.path = path;
+        result.legs = legs;
+        result.dockQueues = dockQueues;
+        result.portCount = len;
+        result.cost = minCost[destIdx];
+        result.hours = totalTime[destIdx];
+        result.queueWaitHours = queueWaitTime[destIdx];
+    }
+    
+    // Console report for a queryCheapestRoute result. Ships are queued in
+    // the result's dock queues at each connection as it is shown; legs go
+    // into journey when it is given.
+    void renderRouteResult(const RouteResult& result, int srcIdx, int destIdx, 
+                           const char* preferredDate, const UserPreferences* prefs,
+                           Journey* journey) {
+        switch (result.status) {
+            case QUERY_INVALID_PORT:
+                cout << "\n❌ Invalid port indices!\n";
+                return;
+            case QUERY_INVALID_DATE:
+                cout << "\n❌ Invalid date format!\n";
+                return;
+            case QUERY_SAME_PORT:
+                cout << "\n❌ Source and destination are the same!\n";
+                return;
+            case QUERY_AVOIDS_ENDPOINT:
+                cout << "\n❌ Cannot avoid source or destination port!\n";
+                return;
+            case QUERY_NO_MEMORY:
+                cout << "\n❌ Not enough memory for route search!\n";
+                return;
+            case QUERY_NO_ROUTE:
+                cout << "\n❌ No route found from " << ports[srcIdx].portName 
+                     << " to " << ports[destIdx].portName;
+                if (prefs && prefs->hasAnyFilter()) {
+                    cout << " matching your preferences";
+                }
+                cout << "\n";
+                if (result.routesFiltered > 0) {
+                    cout << "(" << result.routesFiltered << " routes filtered out by preferences)\n";
+                }
+                return;
+        }
 
+        const char* algoName = result.usedAStar ? "A* ALGORITHM" : "DIJKSTRA'S ALGORITHM";
+        
         cout << "\n========== " << algoName << " ==========\n";
         cout << "From: " << ports[srcIdx].portName << "\n";
         cout << "To: " << ports[destIdx].portName << "\n";
@@ -956,30 +1283,27 @@ public:
             }
         }
         
-        cout << "Nodes Explored: " << nodesExplored << "/" << (int)totalPorts;
-        if (routesFiltered > 0) {
-            cout << " (" << routesFiltered << " routes filtered)";
+        cout << "Nodes Explored: " << result.nodesExplored << "/" << totalPorts;
+        if (result.routesFiltered > 0) {
+            cout << " (" << result.routesFiltered << " routes filtered)";
         }
         cout << "\n\n";
-
-        // BUILD MULTI-LEG JOURNEY LINKED LIST
-        Journey* newJourney = new Journey();
-        char journeyName[50];
-        sprintf(journeyName, "%s to %s", ports[srcIdx].portName, ports[destIdx].portName);
-        newJourney->setName(journeyName);
         
+        const unsigned int* path = result.path;
+        RouteNode* const* legs = result.legs;
+        unsigned int last = result.portCount - 1;
         unsigned int totalDocking = 0;
         
-        for (int i = len - 1; i >= 0; i--) {
+        for (unsigned int i = 0; i <= last; i++) {
             cout << ports[path[i]].portName;
             
             // FIX Q4: Show queue count if ships waiting
-            if (i < len - 1 && ports[path[i]].dockQueue->getSize() > 0) {
-                cout << " [" << ports[path[i]].dockQueue->getSize() << " ships]";
+            if (i > 0 && result.dockQueues[path[i]]->getSize() > 0) {
+                cout << " [" << result.dockQueues[path[i]]->getSize() << " ships]";
             }
             
-            if (i > 0 && routes[i-1]) {
-                RouteNode* r = routes[i-1];
+            if (i < last && legs[i]) {
+                RouteNode* r = legs[i];
                 cout << "\n  ↓ [" << r->shippingCompany << "] "
                      << r->departureTime << " (" << r->voyageDate << ") "
                      << "→ " << r->arrivalTime << " | $" << r->voyageCost;
@@ -988,9 +1312,9 @@ public:
                 unsigned int queueWait = 0;
                 unsigned int dockCharge = 0;
                 
-                if (i > 1 && routes[i-2]) {
-                    layover = calculateLayoverHours(r->arrivalMins, routes[i-2]->departureMins);
-                    queueWait = ports[path[i]].dockQueue->calculateWaitTime(r->arrivalMins) / 60;
+                if (i + 1 < last && legs[i + 1]) {
+                    layover = calculateLayoverHours(r->arrivalMins, legs[i + 1]->departureMins);
+                    queueWait = result.dockQueues[path[i]]->calculateWaitTime(r->arrivalMins) / 60;
                     int totalWait = layover + queueWait;
                     
                     if (layover > 0 || queueWait > 0) {
@@ -1009,53 +1333,82 @@ public:
                     }
                     
                     // Add ship to queue for simulation
-                    ports[path[i]].dockQueue->enqueue(
+                    result.dockQueues[path[i]]->enqueue(
                         r->shippingCompany,
                         r->arrivalMins,
                         120  // FIX Q3: Fixed service time
                     );
                 }
                 
-                // ADD LEG TO JOURNEY LINKED LIST
-                newJourney->addLeg(
-                    ports[path[i]].portName,
-                    ports[path[i-1]].portName,
-                    r->voyageDate,
-                    r->departureTime,
-                    r->arrivalTime,
-                    r->voyageCost,
-                    r->shippingCompany,
-                    r->departureMins,
-                    r->arrivalMins,
-                    layover,
-                    queueWait,
-                    dockCharge
-                );
+                if (journey) {
+                    journey->addLeg(
+                        ports[path[i]].portName,
+                        ports[path[i + 1]].portName,
+                        r->voyageDate,
+                        r->departureTime,
+                        r->arrivalTime,
+                        r->voyageCost,
+                        r->shippingCompany,
+                        r->departureMins,
+                        r->arrivalMins,
+                        layover,
+                        queueWait,
+                        dockCharge
+                    );
+                }
                 
                 cout << "\n\n";
             }
         }
 
         cout << "====================================\n";
-        cout << "Voyage Cost: $" << minCost[destIdx] - totalDocking << "\n";
-        if (queueWaitTime[destIdx] > 0) {
-            cout << "Queue Wait Time: " << queueWaitTime[destIdx] << " hours\n";
+        cout << "Voyage Cost: $" << result.cost - totalDocking << "\n";
+        if (result.queueWaitHours > 0) {
+            cout << "Queue Wait Time: " << result.queueWaitHours << " hours\n";
         }
-        cout << "Total Time: " << totalTime[destIdx] << " hours\n";
+        cout << "Total Time: " << result.hours << " hours\n";
         if (totalDocking > 0) {
             cout << "Port Docking Charges: $" << totalDocking << "\n";
         }
-        cout << "TOTAL COST: $" << minCost[destIdx] << "\n";
+        cout << "TOTAL COST: $" << result.cost << "\n";
         cout << "====================================\n\n";
+    }
+
+    // Runs the query and prints it; with saveJourney, also records it as a
+    // Journey while there is room. Returns the saved journey, or NULL.
+    Journey* findCheapestRoute(int srcIdx, int destIdx, const char* preferredDate, 
+                          bool useAStar = false, const UserPreferences* prefs = NULL,
+                          bool saveJourney = false) {
+        SearchScratch scratch(totalPorts);
+        RouteResult result;
+        queryCheapestRoute(srcIdx, destIdx, preferredDate, useAStar, prefs, scratch, result);
+        
+        Journey* newJourney = NULL;
+        if (result.status == QUERY_FOUND && saveJourney && journeyCount < MAX_SAVED_JOURNEYS) {
+            newJourney = new (nothrow) Journey();
+        }
+        if (newJourney) {
+            char journeyName[MAX_JOURNEY_NAME_LENGTH];
+            snprintf(journeyName, sizeof(journeyName), "%s to %s", ports[srcIdx].portName, ports[destIdx].portName);
+            newJourney->setName(journeyName);
+        }
+        
+        renderRouteResult(result, srcIdx, destIdx, preferredDate, prefs, newJourney);
+        
+        // The ports show the queues simulated by the last search
+        if (result.status == QUERY_FOUND || result.status == QUERY_NO_ROUTE) {
+            for (unsigned int i = 0; i < totalPorts; i++) {
+                DockingQueue* shown = scratch.dockQueues[i];
+                scratch.dockQueues[i] = ports[i].dockQueue;
+                ports[i].dockQueue = shown;
+            }
+        }
         
-        // SAVE JOURNEY IF REQUESTED
-        if (saveJourney && journeyCount < MAX_SAVED_JOURNEYS) {
+        if (newJourney) {
             savedJourneys[journeyCount] = newJourney;
             journeyCount++;
             cout << "✅ Journey saved! (Total saved: " << journeyCount << ")\n\n";
-            return newJourney;
         }
-        
         return newJourney;
     }
 
@@ -1260,7 +1613,7 @@ public:
                     
                     cout << "\n--- Find Cheapest Route ---\n";
                     cout << "Ports: ";
-                    for (unsigned char i = 0; i < totalPorts; i++) {
+                    for (unsigned int i = 0; i < totalPorts; i++) {
                         cout << ports[i].portName;
                         if (i < totalPorts - 1) cout << ", ";
                     }
@@ -1291,12 +1644,10 @@ public:
                         
                         if (hasDirectRoute) {
                             cout << "\n🎯 Direct route detected - Using A* algorithm\n";
-                            Journey* j = findCheapestRoute(si, di, date, true, NULL, shouldSave);
-                            if (!shouldSave && j) delete j;
+                            findCheapestRoute(si, di, date, true, NULL, shouldSave);
                         } else {
                             cout << "\n🔍 Multi-hop route needed - Using Dijkstra's algorithm\n";
-                            Journey* j = findCheapestRoute(si, di, date, false, NULL, shouldSave);
-                            if (!shouldSave && j) delete j;
+                            findCheapestRoute(si, di, date, false, NULL, shouldSave);
                         }
                     }
                     break;
@@ -1308,7 +1659,7 @@ public:
                     
                     cout << "\n--- Find Route with Custom Preferences ---\n";
                     cout << "Ports: ";
-                    for (unsigned char i = 0; i < totalPorts; i++) {
+                    for (unsigned int i = 0; i < totalPorts; i++) {
                         cout << ports[i].portName;
                         if (i < totalPorts - 1) cout << ", ";
                     }
@@ -1341,12 +1692,10 @@ public:
                         
                         if (hasDirectRoute && !prefs.hasAnyFilter()) {
                             cout << "\n🎯 Direct route detected - Using A* algorithm\n";
-                            Journey* j = findCheapestRoute(si, di, date, true, &prefs, shouldSave);
-                            if (!shouldSave && j) delete j;
+                            findCheapestRoute(si, di, date, true, &prefs, shouldSave);
                         } else {
                             cout << "\n🔍 Multi-hop/Filtered route - Using Dijkstra's algorithm\n";
-                            Journey* j = findCheapestRoute(si, di, date, false, &prefs, shouldSave);
-                            if (!shouldSave && j) delete j;
+                            findCheapestRoute(si, di, date, false, &prefs, shouldSave);
                         }
                     }
                     break;
@@ -1375,7 +1724,7 @@ public:
     }
 
     ~Graph() {
-        for (unsigned char i = 0; i < totalPorts; i++) {
+        for (unsigned int i = 0; i < totalPorts; i++) {
             RouteNode* curr = ports[i].routeListHead;
             while (curr) {
                 RouteNode* temp = curr;
@@ -1384,6 +1733,8 @@ public:
             }
         }
         
+        delete[] ports;
+        
         for (int i = 0; i < journeyCount; i++) {
             delete savedJourneys[i];
         }